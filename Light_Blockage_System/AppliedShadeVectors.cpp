@@ -0,0 +1,70 @@
+#include <algorithm>
+
+#include "AppliedShadeVectors.h"
+#include "MathHelper.h"
+
+double AppliedShadeVectors::add(ShadeVectorGraph::Index sv, double percentage) {
+
+	std::size_t i = find(sv);
+
+	if (i < count && svs()[i] == sv)
+		return percentages()[i] += percentage;
+
+	if (count == capacity)
+		grow();
+
+	ShadeVectorGraph::Index* s = svs();
+	double* p = percentages();
+	std::copy_backward(s + i, s + count, s + count + 1);
+	std::copy_backward(p + i, p + count, p + count + 1);
+	s[i] = sv;
+	p[i] = percentage;
+	++count;
+
+	return percentage;
+}
+
+AppliedShadeVectors::subtractResult AppliedShadeVectors::subtract(ShadeVectorGraph::Index sv, double percentage) {
+
+	std::size_t i = find(sv);
+
+	if (i == count || svs()[i] != sv)
+		return notApplied;
+
+	double newPercentage = percentages()[i] - percentage;
+
+	if (newPercentage > 0. && !almostEqual(newPercentage, 0.)) {
+
+		percentages()[i] = newPercentage;
+		return subtracted;
+	}
+
+	// Nothing is left, or less than nothing, which only a caller removing shade it never added can cause
+	ShadeVectorGraph::Index* s = svs();
+	double* p = percentages();
+	std::copy(s + i + 1, s + count, s + i);
+	std::copy(p + i + 1, p + count, p + i);
+	--count;
+
+	return almostEqual(newPercentage, 0.) ? subtracted : overdrawn;
+}
+
+std::size_t AppliedShadeVectors::find(ShadeVectorGraph::Index sv) const {
+
+	const ShadeVectorGraph::Index* s = svs();
+	return static_cast<std::size_t>(std::lower_bound(s, s + count, sv) - s);
+}
+
+void AppliedShadeVectors::grow() {
+
+	std::uint32_t newCapacity = capacity * 2;
+
+	std::unique_ptr<ShadeVectorGraph::Index[]> newSvs(new ShadeVectorGraph::Index[newCapacity]);
+	std::unique_ptr<double[]> newPercentages(new double[newCapacity]);
+	std::copy(svs(), svs() + count, newSvs.get());
+	std::copy(percentages(), percentages() + count, newPercentages.get());
+
+	heapSvs = std::move(newSvs);
+	heapPercentages = std::move(newPercentages);
+	capacity = newCapacity;
+}
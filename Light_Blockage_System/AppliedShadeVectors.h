@@ -0,0 +1,81 @@
+/*
+	The ShadeVectors applied to a unit and the percentage of each.  This is a small flat map kept sorted by ShadeVector index.  The first few
+	entries are stored inline and larger maps spill to the heap, so most units never allocate.
+
+	Percentages are kept as exact doubles.  They are read back as the seeds that remove shade when a unit's blocked state changes, so any
+	rounding here would remove a different amount than was added, and incremental edits would drift from a grid built from scratch.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "ShadeVectorGraph.h"
+
+class AppliedShadeVectors {
+
+public:
+
+	static const std::uint32_t INLINE_CAPACITY = 4;
+
+	enum subtractResult { subtracted, notApplied, overdrawn };
+
+	class const_iterator {
+
+		const AppliedShadeVectors* map = nullptr;
+		std::size_t position = 0;
+
+	public:
+
+		const_iterator(const AppliedShadeVectors* m, std::size_t p) : map(m), position(p) {}
+
+		std::pair<ShadeVectorGraph::Index, double> operator*() const { return { map->svAt(position), map->percentageAt(position) }; }
+		const_iterator& operator++() { ++position; return *this; }
+		bool operator!=(const const_iterator& rhs) const { return position != rhs.position; }
+	};
+
+	AppliedShadeVectors() {}
+	AppliedShadeVectors(const AppliedShadeVectors&) = delete;
+	AppliedShadeVectors& operator=(const AppliedShadeVectors&) = delete;
+
+	std::size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	ShadeVectorGraph::Index svAt(std::size_t i) const { return svs()[i]; }
+	double percentageAt(std::size_t i) const { return percentages()[i]; }
+
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, count); }
+
+	// Adds percentage to sv's percentage, inserting sv if it isn't there, and returns the new percentage
+	double add(ShadeVectorGraph::Index sv, double percentage);
+
+	// Subtracts percentage from sv's percentage and removes sv once nothing is left.  Nothing changes if sv isn't there.  If more is removed
+	// than was applied, sv is removed and overdrawn is returned.
+	subtractResult subtract(ShadeVectorGraph::Index sv, double percentage);
+
+private:
+
+	std::uint32_t count = 0;
+	std::uint32_t capacity = INLINE_CAPACITY;
+
+	ShadeVectorGraph::Index inlineSvs[INLINE_CAPACITY] = {};
+	double inlinePercentages[INLINE_CAPACITY] = {};
+
+	// Only used once there are more than INLINE_CAPACITY entries
+	std::unique_ptr<ShadeVectorGraph::Index[]> heapSvs;
+	std::unique_ptr<double[]> heapPercentages;
+
+	ShadeVectorGraph::Index* svs() { return heapSvs ? heapSvs.get() : inlineSvs; }
+	const ShadeVectorGraph::Index* svs() const { return heapSvs ? heapSvs.get() : inlineSvs; }
+	double* percentages() { return heapPercentages ? heapPercentages.get() : inlinePercentages; }
+	const double* percentages() const { return heapPercentages ? heapPercentages.get() : inlinePercentages; }
+
+	// Position of sv, or of where it would be inserted
+	std::size_t find(ShadeVectorGraph::Index sv) const;
+
+	void grow();
+};
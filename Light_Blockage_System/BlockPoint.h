@@ -1,8 +1,6 @@
 #pragma once
 
-#include <memory>
 #include <map>
-#include <unordered_set>
 #include <time.h>
 
 #include <maya/MString.h>
@@ -11,56 +9,61 @@
 #include <maya/MFnMesh.h>
 #include <maya/MFnSet.h>
 
+#include "CoverageStencil.h"
 #include "Point_Int.h"
 #include "SimpleShapes.h"
+#include "SlotMap.h"
 
-class BlockPointGrid;
+// Identifies a block point in its grid.  Handles stay valid until the block point is deleted.
+typedef SlotMapHandle BlockPointHandle;
 
-class BlockPoint : public std::enable_shared_from_this<BlockPoint> {
+class BlockPoint {
 
 	MString name;
 	MPoint loc;
 
+	// Unique within the block point's grid
+	int id = -1;
+
 	// density was originally intended to allow for values between 0 and 1, so that BlockPoints could partially block the grid units they occupy.
 	// Currently the BlockPointGrid is only designed to handle a density value of 1, meaning BlockPoints fully block the unit(s) they occupy.
 	int density = 1;
 	double radius = 1.;
-	std::unordered_set<Point_Int, Point_Int::HashFunction> indicesInRadius;
 	Point_Int gridIndex;
+
+	// The units the block point covers, as offsets from gridIndex.  Owned by the grid's stencil cache.
+	const CoverageStencil* coverage = nullptr;
 	
 	// For debugging only. Used to trigger moveBlockPoint in callback
 	clock_t timeSinceLastMoved = 0;
-	BlockPointGrid* grid = nullptr;
 	Point_Int currentUnit = Point_Int(0, 0, 0);
 	MObject bpTransformNode;
 
 public:
 
-	BlockPoint(const MPoint& LOC, int DENSITY, double RADIUS, Point_Int GRIDINDEX, int number) : loc(LOC), density(DENSITY), radius(RADIUS), gridIndex(GRIDINDEX) {
+	BlockPoint(const MPoint& LOC, int DENSITY, double RADIUS, Point_Int GRIDINDEX, int ID) : loc(LOC), id(ID), density(DENSITY), radius(RADIUS), gridIndex(GRIDINDEX) {
 
-		std::string n = "bp_" + std::to_string(number);
+		std::string n = "bp_" + std::to_string(ID);
 		name = n.c_str();
 	}
 
+	int getId() const { return id; }
+
 	MObject getTransformNode() { return bpTransformNode; }
 
 	Point_Int getGridIndex() const { return gridIndex; }
 	void setGridIndex(Point_Int index) { gridIndex = index; }
 
-	std::unordered_set<Point_Int, Point_Int::HashFunction> getIndicesInRadius() { return indicesInRadius; }
-	void setIndicesInRadius(std::unordered_set<Point_Int, Point_Int::HashFunction> iir) { indicesInRadius = iir; }
+	const CoverageStencil* getCoverage() const { return coverage; }
+	void setCoverage(const CoverageStencil* c) { coverage = c; }
 
 	Point_Int getCurrentUnit() const { return currentUnit; }
 	void setCurrentUnit(Point_Int u) { currentUnit = u; }
 
 	double getDensity() const { return density; }
+	MPoint getLoc() const { return loc; }
 	void setLoc(MPoint p) { loc = p; }
 
-	BlockPointGrid* getGrid() const { return grid; }
-	void setGrid(BlockPointGrid* g) { grid = g; }
-
-	std::shared_ptr<BlockPoint> getSharedFromThis() { return shared_from_this(); }
-
 	/*** Display / Debug Tools ***/
 
 	// Create a mesh for the block point and add it as a child of the bp mesh group
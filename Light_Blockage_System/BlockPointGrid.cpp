@@ -3,6 +3,7 @@ BlockPointGrid.cpp
 */
 
 #include <math.h>
+#include <algorithm>
 #include <map>
 #include "BlockPointGrid.h"
 
@@ -11,77 +12,69 @@ void BlockPointGrid::createShadeVectorGraph() {
 	MGlobal::displayInfo(MString() + "*** Entered createShadeVectorGraph ***");
 	MStatus status;
 
-	// Precalculate subdivision size and volume. There will be 8^timesToSubDivide subdivisions for each unit. 
-	int timesToSubDivide = 3;
-	double subdivisionSize = unitSize * std::pow(.5, timesToSubDivide);
-	double subdivisionVolume = std::pow(subdivisionSize, 3);
+	// Grids are frequently recreated with the same parameters, so check for a graph that has already been built and saved
+	ShadeVectorGraphKey cacheKey = { unitSize, shadeRange, halfConeAngle, subdivisionDepth };
+	std::string cachePath = ShadeVectorGraphCache::getCachePath(cacheKey);
+	if (ShadeVectorGraphCache::load(cachePath, cacheKey, shadeVectorGraph, maxVolumeBlocked)) {
 
-	// Key:  ShadeVector
-	// Value:  Locations of the subdivisions within the ShadeVector's unit
-	std::unordered_map< ShadeVector*, std::vector<MVector>> subdivisionsByUnit;
+		MGlobal::displayInfo(MString() + "*** Loaded ShadeVector graph from " + cachePath.c_str() + " ***");
+		shadeVectorGraph.buildFreeFieldStencil();
+		return;
+	}
+
+	// Subdivisions that straddle a boundary are divided until they reach this size.  At most there will be 8^subdivisionDepth subdivisions for each unit.
+	double minSubdivisionSize = unitSize * std::pow(.5, subdivisionDepth);
+
+	// Key:  Vector to a unit in the canonical octant
+	// Value:  The subdivisions within the unit that are in shade range.  Those of every other unit are mirrored from these when needed.
+	std::unordered_map<Point_Int, std::vector<Subdivision>, Point_Int::HashFunction> canonicalSubdivisions;
 
-	// Key:  ShadeVector
-	// Value:  Locations of all subdivisions for the ShadeVector
-	std::unordered_map<ShadeVector*, std::vector<MVector>> totalOccludedVolumesByShadeVectors;
+	// Key:  ShadeVector in the canonical octant
+	// Value:  All subdivisions occluded by the ShadeVector
+	std::unordered_map<ShadeVector*, std::vector<Subdivision>> totalOccludedVolumesByShadeVectors;
 
 	MGlobal::displayInfo(MString() + "*** Finding ShadeVectors and their subdivisions ***");
 
+	// All ShadeVectors in the graph, in the order they were found
+	std::vector<ShadeVector*> allShadeVectors;
+
 	// Find all shade vectors in shade range and populate the two maps
-	findAllShadeVectorSubdivisions(subdivisionsByUnit, totalOccludedVolumesByShadeVectors, subdivisionVolume, timesToSubDivide);
+	findAllShadeVectorSubdivisions(canonicalSubdivisions, totalOccludedVolumesByShadeVectors, allShadeVectors, minSubdivisionSize);
 
-	MGlobal::displayInfo(MString() + "*** Finding volume blocked ***");
+	MGlobal::displayInfo(MString() + "*** Finding volume blocked using " + resolveThreadCount(threadCount) + " threads (" + rayFaceKernelInstructionSet() + ") ***");
 
 	// Compute the total volume occluded by each ShadeVector as well as that shared by neighbors. 
-	std::unordered_set<ShadeVector*> done;
-	findAllShadedVolume(shadeRoot.get(), subdivisionsByUnit, totalOccludedVolumesByShadeVectors, done, subdivisionVolume, subdivisionSize);
+	findAllShadedVolume(allShadeVectors, canonicalSubdivisions, totalOccludedVolumesByShadeVectors, minSubdivisionSize);
 
 	// Adjust the value of the volume that ShadeVectors share with their neighbors so it is more accurate
 	finalizeSharedVolumeBlocked();
 
 	// Uncomment the following line to display the range of the shade vector graph.  Each unit represents a ShadeVector and will have
 	// channels indicating the amount of shared volume for each of its child ShadeVectors
-	//displayShadeVectorUnitsByLevel(subdivisionSize, totalOccludedVolumesByShadeVectors);
+	//displayShadeVectorUnitsByLevel(totalOccludedVolumesByShadeVectors);
+
+	// Propagation only uses the frozen graph, so the ShadeVectors can be released once it has been made
+	shadeVectorGraph.freeze(*shadeRoot);
+	shadeRoot->neighborShadeVectors.clear();
+
+	if (!ShadeVectorGraphCache::save(cachePath, cacheKey, shadeVectorGraph, maxVolumeBlocked))
+		MGlobal::displayWarning(MString() + "Could not write ShadeVector graph cache to " + cachePath.c_str());
 }
 
 MStatus BlockPointGrid::initiateGrid() {
 
 	MStatus status;
 
-	double xCoord = base.x - (unitSize * (xElements / 2.)) + (unitSize * .5);
-
-	for (int xI = 0; xI < xElements; ++xI) {
-
-		double yCoord = base.y + (unitSize * .5);
-
-		grid.push_back(std::vector< std::vector<GridUnit> >());
-
-		for (int yI = 0; yI < yElements; ++yI) {
-
-			double zCoord = base.z - (unitSize * (zElements / 2.)) + (unitSize * .5);
-
-			grid.back().push_back(std::vector<GridUnit>());
+	// Units are centered on the Maya grid in x and z, and sit on top of base
+	MPoint firstCenter(base.x - (unitSize * (xElements / 2.)) + (unitSize * .5), base.y + (unitSize * .5), base.z - (unitSize * (zElements / 2.)) + (unitSize * .5));
+	units.initialize(id, xElements, yElements, zElements, unitSize, firstCenter, sparse);
+	units.setStaleLightEvaluator([this](std::uint32_t i) { evaluateStaleUnits({ i }); });
+	coverageStencils.setGridSize(xElements, yElements, zElements);
 
-			for (int zI = 0; zI < zElements; ++zI) {
-
-				std::string unitName = "g_" + std::to_string(id) + "_unit_" + std::to_string(xI) + "_" + std::to_string(yI) + "_" + std::to_string(zI);
-				Point_Int newUnitIndex = pointToIndex(MPoint(xCoord, yCoord, zCoord));
-				GridUnit newUnit(unitName.c_str(), xCoord, yCoord, zCoord, newUnitIndex);
-				grid.back().back().push_back(newUnit);
-
-				zCoord += unitSize;
-			}
-
-			yCoord += unitSize;
-		}
-
-		xCoord += unitSize;
-
-		MStreamUtils::stdOutStream() << "Layer " << xI << " created\n";
-	}
-
-	grid.back().back().shrink_to_fit();
-	grid.back().shrink_to_fit();
-	grid.shrink_to_fit();
+	xCells = (xElements + OCCUPANCY_CELL_SIZE - 1) / OCCUPANCY_CELL_SIZE;
+	yCells = (yElements + OCCUPANCY_CELL_SIZE - 1) / OCCUPANCY_CELL_SIZE;
+	zCells = (zElements + OCCUPANCY_CELL_SIZE - 1) / OCCUPANCY_CELL_SIZE;
+	blockedUnitsByCell.assign(static_cast<std::size_t>(xCells) * yCells * zCells, 0);
 
 	// Create grid group as a transform
 	MFnDagNode gridGroupDagNodeFn;
@@ -113,7 +106,7 @@ MStatus BlockPointGrid::initiateGrid() {
 }
 
 BlockPointGrid::BlockPointGrid(int id, double XSIZE, double YSIZE, double ZSIZE, double UNITSIZE, const MPoint BASE, double DETECTIONRANGE, double CONERANGEANGLE,
-	double INTENSITY) {
+	double INTENSITY, int SUBDIVISIONDEPTH, unsigned int THREADS, bool SPARSE) {
 
 	//timer.start(clock());
 	this->id = id;
@@ -132,12 +125,17 @@ BlockPointGrid::BlockPointGrid(int id, double XSIZE, double YSIZE, double ZSIZE,
 	shadeRange = DETECTIONRANGE;
 	halfConeAngle = CONERANGEANGLE;
 	intensity = INTENSITY;
+	subdivisionDepth = SUBDIVISIONDEPTH;
+	threadCount = THREADS;
+	sparse = SPARSE;
 
 	setShadingGroups();
 	createShadeVectorGraph();
 	initiateGrid();
 
 	MGlobal::displayInfo(MString() + "Grid created with " + (xElements * yElements * zElements) + " units.");
+	if (sparse)
+		MGlobal::displayInfo(MString() + "	Units are allocated in bricks of " + GridUnitStore::BRICK_UNITS + " as they are used");
 	MGlobal::displayInfo(MString() + "	xElements: " + xElements + ", yElements: " + yElements + ", zElements: " + zElements);
 	MGlobal::displayInfo(MString() + "	unitSize: " + unitSize);
 	MGlobal::displayInfo(MString() + "	base: (" + base.x + ", " + base.y + ", " + base.z + ")");
@@ -145,6 +143,8 @@ BlockPointGrid::BlockPointGrid(int id, double XSIZE, double YSIZE, double ZSIZE,
 	MGlobal::displayInfo(MString() + "	shadeRange: " + shadeRange);
 	MGlobal::displayInfo(MString() + "	halfConeAngle: " + halfConeAngle);
 	MGlobal::displayInfo(MString() + "	intensity: " + intensity);
+	MGlobal::displayInfo(MString() + "	subdivisionDepth: " + subdivisionDepth);
+	MGlobal::displayInfo(MString() + "	threads: " + resolveThreadCount(threadCount));
 	MGlobal::displayInfo(MString() + "	maxVolumeBlocked: " + maxVolumeBlocked);
 
 	// Clear any selection
@@ -165,40 +165,240 @@ Point_Int BlockPointGrid::pointToIndex(const MPoint& p) const {
 	return Point_Int(xInd, yInd, zInd);
 }
 
-std::unordered_set<Point_Int, Point_Int::HashFunction> BlockPointGrid::getIndicesInRadius(const MPoint& loc, const Point_Int bpUnitIndex, double radius) {
+void BlockPointGrid::queryLight(const double* x, const double* y, const double* z, std::size_t count, double* shade, double* lightX, double* lightY,
+	double* lightZ) {
 
-	std::queue<Point_Int> unitQueue;
-	unitQueue.push(bpUnitIndex);
-	std::unordered_set<Point_Int, Point_Int::HashFunction> unitsInRange;
-	unitsInRange.insert(bpUnitIndex);
+	// Gathering is done in parallel, so the stale units it will read are evaluated beforehand
+	if (!staleUnits.empty()) {
 
-	while (!unitQueue.empty()) {
+		std::vector<std::uint32_t> staleCorners;
+		for (std::size_t i = 0; i < count; ++i) {
 
-		Point_Int currentIndex = unitQueue.front();
-		unitQueue.pop();
-		for (auto& d : UNIT_NEIGHBOR_DIRECTIONS) {
+			std::uint32_t cellCorners[8];
+			double fraction[3];
+			findLightCell(x[i], y[i], z[i], cellCorners, fraction);
 
-			Point_Int neighbor = currentIndex + d;
+			for (std::uint32_t unit : cellCorners) {
 
-			if (unitsInRange.find(neighbor) == unitsInRange.end()) {
+				if (unit != GridUnitStore::NO_UNIT && units.isLightStale(unit))
+					staleCorners.push_back(unit);
+			}
+		}
 
-				if (indicesAreOnGrid(neighbor.x, neighbor.y, neighbor.z)) {
+		std::sort(staleCorners.begin(), staleCorners.end());
+		staleCorners.erase(std::unique(staleCorners.begin(), staleCorners.end()), staleCorners.end());
+		evaluateStaleUnits(staleCorners);
+	}
 
-					double proximity = (grid[neighbor.x][neighbor.y][neighbor.z].getCenter() - loc).length();
-					if (proximity < radius) {
+	const std::size_t blockSize = LightCorners::BLOCK_SIZE;
+	const double fallbackDirection[3] = { unblockedLightDirection.x, unblockedLightDirection.y, unblockedLightDirection.z };
 
-						unitQueue.push(neighbor);
-						unitsInRange.insert(neighbor);
-					}
-				}
-			}
+	parallelFor((count + blockSize - 1) / blockSize, count >= MIN_PARALLEL_LIGHT_QUERIES ? threadCount : 1, [&](std::size_t block) {
+
+		LightCorners corners;
+		std::size_t begin = block * blockSize;
+		std::size_t pointCount = std::min(blockSize, count - begin);
+
+		for (std::size_t i = 0; i < pointCount; ++i)
+			gatherLightCorners(x[begin + i], y[begin + i], z[begin + i], corners, i);
+
+		blendLightCorners(corners, pointCount, fallbackDirection, shade + begin, lightX + begin, lightY + begin, lightZ + begin);
+	});
+}
+
+void BlockPointGrid::findLightCell(double px, double py, double pz, std::uint32_t (&cellCorners)[8], double (&fraction)[3]) const {
+
+	MPoint firstCenter = units.center(0, 0, 0);
+	const double position[3] = { (px - firstCenter.x) / unitSize, (py - firstCenter.y) / unitSize, (pz - firstCenter.z) / unitSize };
+	const int elements[3] = { xElements, yElements, zElements };
+
+	// The grid index of the first corner along each axis, and the step to the last, which is 0 at the grid's edge
+	int first[3];
+	int step[3];
+
+	for (int axis = 0; axis < 3; ++axis) {
+
+		double u = position[axis];
+		int lastIndex = elements[axis] - 1;
+
+		// Written so that a point that isn't a number lands on the first unit
+		if (!(u > 0.)) {
+
+			first[axis] = 0;
+			fraction[axis] = 0.;
+		}
+		else if (u >= lastIndex) {
+
+			first[axis] = lastIndex;
+			fraction[axis] = 0.;
+		}
+		else {
+
+			double floor = std::floor(u);
+			first[axis] = static_cast<int>(floor);
+			fraction[axis] = u - floor;
 		}
+
+		step[axis] = first[axis] < lastIndex ? 1 : 0;
+	}
+
+	units.findCellCorners(first[0], first[1], first[2], step[0], step[1], step[2], cellCorners);
+}
+
+void BlockPointGrid::gatherLightCorners(double px, double py, double pz, LightCorners& corners, std::size_t i) const {
+
+	std::uint32_t cellCorners[8];
+	double fraction[3];
+	findLightCell(px, py, pz, cellCorners, fraction);
+
+	for (int axis = 0; axis < 3; ++axis)
+		corners.fraction[axis][i] = fraction[axis];
+
+	for (int c = 0; c < 8; ++c) {
+
+		std::uint32_t unit = cellCorners[c];
+		const MVector& direction = unit == GridUnitStore::NO_UNIT ? unblockedLightDirection : units.lightDirection(unit);
+
+		corners.shade[c][i] = unit == GridUnitStore::NO_UNIT ? 0. : units.shadePercentage(unit);
+		corners.direction[0][c][i] = direction.x;
+		corners.direction[1][c][i] = direction.y;
+		corners.direction[2][c][i] = direction.z;
+	}
+}
+
+double BlockPointGrid::getShadePercentage(int x, int y, int z) {
+
+	std::uint32_t i = units.findLinearIndex(x, y, z);
+	if (i == GridUnitStore::NO_UNIT)
+		return 0.;
+
+	if (units.isLightStale(i))
+		evaluateStaleUnits({ i });
+
+	return units.shadePercentage(i);
+}
+
+MVector BlockPointGrid::getLightDirection(int x, int y, int z) {
+
+	std::uint32_t i = units.findLinearIndex(x, y, z);
+	if (i == GridUnitStore::NO_UNIT)
+		return unblockedLightDirection;
+
+	if (units.isLightStale(i))
+		evaluateStaleUnits({ i });
+
+	return units.lightDirection(i);
+}
+
+void BlockPointGrid::setLazyLightConditions(bool lazy) {
+
+	lazyLightConditions = lazy;
+
+	if (!lazy)
+		flushLightConditions();
+}
+
+void BlockPointGrid::flushLightConditions() {
+
+	evaluateStaleUnits(std::vector<std::uint32_t>(staleUnits.begin(), staleUnits.end()));
+}
+
+void BlockPointGrid::flushLightConditions(const Point_Int& startInd, const Point_Int& endInd) {
+
+	if (staleUnits.empty())
+		return;
+
+	std::vector<std::uint32_t> stale;
+	traverseRange(startInd, endInd, [&](GridUnit& unit) {
+
+		if (units.isLightStale(unit.getLinearIndex()))
+			stale.push_back(unit.getLinearIndex());
+	});
+
+	evaluateStaleUnits(stale);
+}
+
+void BlockPointGrid::markLightStale(std::uint32_t i) {
+
+	std::uint8_t& stale = units.lightStale(i);
+	if (!stale) {
+
+		stale = 1;
+		staleUnits.insert(i);
 	}
+}
+
+void BlockPointGrid::evaluateStaleUnits(const std::vector<std::uint32_t>& unitIndices) {
+
+	std::vector<std::uint32_t> stale;
+	stale.reserve(unitIndices.size());
+	for (std::uint32_t i : unitIndices) {
+
+		if (units.isLightStale(i))
+			stale.push_back(i);
+	}
+
+	const std::size_t blockSize = LightConditionBlock::BLOCK_SIZE;
+	const double unblocked[3] = { unblockedLightDirection.x, unblockedLightDirection.y, unblockedLightDirection.z };
+
+	// Each unit is in only one block, so blocks write to different units
+	parallelFor((stale.size() + blockSize - 1) / blockSize, stale.size() >= MIN_PARALLEL_LIGHT_EVALUATIONS ? threadCount : 1, [&](std::size_t b) {
+
+		LightConditionBlock block;
+		std::size_t begin = b * blockSize;
+		std::size_t unitCount = std::min(blockSize, stale.size() - begin);
+
+		for (std::size_t k = 0; k < unitCount; ++k) {
 
-	return unitsInRange;
+			std::uint32_t i = stale[begin + k];
+			const MVector& shadeVectorSum = units.shadeVectorSum(i);
+			const MVector& lightDirection = units.lightDirection(i);
+
+			block.totalVolumeBlocked[k] = units.totalVolumeBlocked(i);
+			block.shadeVectorSum[0][k] = shadeVectorSum.x;
+			block.shadeVectorSum[1][k] = shadeVectorSum.y;
+			block.shadeVectorSum[2][k] = shadeVectorSum.z;
+			block.lightDirection[0][k] = lightDirection.x;
+			block.lightDirection[1][k] = lightDirection.y;
+			block.lightDirection[2][k] = lightDirection.z;
+		}
+
+		evaluateLightConditions(block, unitCount, intensity, maxVolumeBlocked, unblocked);
+
+		for (std::size_t k = 0; k < unitCount; ++k) {
+
+			std::uint32_t i = stale[begin + k];
+			units.shadePercentage(i) = block.shadePercentage[k];
+			units.lightDirection(i) = MVector(block.lightDirection[0][k], block.lightDirection[1][k], block.lightDirection[2][k]);
+			units.lightStale(i) = 0;
+
+			// The blockage is straight against the unblocked direction, so the turn is left to updateLightConditions' choice of axis
+			if (block.unresolved[k])
+				unitAt(i).updateLightConditions(intensity, maxVolumeBlocked, unblockedLightDirection);
+		}
+	});
+
+	for (std::uint32_t i : stale)
+		staleUnits.erase(i);
+}
+
+const CoverageStencil* BlockPointGrid::getCoverageStencil(const MPoint& loc, const Point_Int bpUnitIndex, double radius) {
+
+	MVector subUnitOffset = (loc - units.center(bpUnitIndex.x, bpUnitIndex.y, bpUnitIndex.z)) / unitSize;
+	return coverageStencils.get(radius / unitSize, subUnitOffset);
 }
 
-MStatus BlockPointGrid::addBlockPoint(const MPoint loc, double bpDensity, double bpRadius, std::shared_ptr<BlockPoint>& ptrForSeg) {
+BlockPointHandle BlockPointGrid::createBlockPoint(const MPoint& loc, double bpDensity, double bpRadius, const Point_Int& unitIndex) {
+
+	int bpId = nextBlockPointId++;
+	BlockPointHandle handle = blockPoints.emplace(loc, static_cast<int>(std::round(bpDensity)), bpRadius, unitIndex, bpId);
+	blockPoints.get(handle)->setCoverage(getCoverageStencil(loc, unitIndex, bpRadius));
+	blockPointIds[bpId] = handle;
+
+	return handle;
+}
+
+MStatus BlockPointGrid::addBlockPoint(const MPoint loc, double bpDensity, double bpRadius, BlockPointHandle& handleForSeg) {
 
 	Point_Int unitIndex = pointToIndex(loc);
 
@@ -206,222 +406,862 @@ MStatus BlockPointGrid::addBlockPoint(const MPoint loc, double bpDensity, double
 		return MS::kFailure;
 
 	// Only BlockPointGrid creates new BlockPoints, however there are two handles to each BlockPoint - one for the bpg and one for the Segment that the bp sits on
-	std::shared_ptr<BlockPoint> newBP = std::make_shared<BlockPoint>(loc, static_cast<int>(std::round(bpDensity)), bpRadius, unitIndex, static_cast<int>(blockPoints.size()));
+	handleForSeg = createBlockPoint(loc, bpDensity, bpRadius, unitIndex);
+	BlockPoint* newBP = blockPoints.get(handleForSeg);
+
+	forEachCoveredIndex(*newBP, [&](const Point_Int& i) {
+
+		GridUnit unit = unitAt(i.x, i.y, i.z);
+		unit.adjustDensityIncludingExcess(add * static_cast<int>(std::round(bpDensity)));
+		dirtyDensityUnits.insert(unit.getLinearIndex());
+	});
+
+	return MS::kSuccess;
+}
+
+MStatus BlockPointGrid::moveBlockPoint(BlockPoint& bp, const MPoint newLoc) {
+
+	Point_Int newUnitIndex = pointToIndex(newLoc);
+
+	if (!indicesAreInRange_showError(newUnitIndex.x, newUnitIndex.y, newUnitIndex.z))
+		return MS::kFailure;
+
+	Point_Int bpGridIndex = bp.getGridIndex();
+	if (newUnitIndex != bpGridIndex) {
+
+		// Since BlockPoints' radius allows them to affect many units, only the units its coverage stencil leaves or enters when shifted by the move
+		// have changed densities, so only they are used to adjust the grid.
+		Point_Int moveVector = newUnitIndex - bpGridIndex;
+		addMoveVectorToBP(bp, moveVector);
+		bp.setGridIndex(newUnitIndex);
+	}
+
+	// set the new location for the block point
+	bp.setLoc(newLoc);
+
+	return MS::kSuccess;
+}
+
+void BlockPointGrid::deleteBlockPoint(const BlockPointHandle& handle) {
+
+	BlockPoint* bp = blockPoints.get(handle);
+	if (!bp)
+		return;
+
+	// remove the bp's effect on the grid
+	forEachCoveredIndex(*bp, [&](const Point_Int& i) {
+
+		GridUnit unit = unitAt(i.x, i.y, i.z);
+		unit.adjustDensityIncludingExcess(subtract * bp->getDensity());
+		dirtyDensityUnits.insert(unit.getLinearIndex());
+	});
+
+	// remove the bp from the bpg
+	blockPointIds.erase(bp->getId());
+	blockPoints.erase(handle);
+}
+
+MStatus BlockPointGrid::addBlockPoints(const std::vector<MPoint>& locs, const std::vector<double>& densities, const std::vector<double>& radii, std::vector<BlockPointHandle>& handles) {
+
+	MStatus status = MS::kSuccess;
+
+	if ((densities.size() != 1 && densities.size() != locs.size()) || (radii.size() != 1 && radii.size() != locs.size())) {
+
+		MGlobal::displayError(MString() + "Expected 1 or " + static_cast<unsigned int>(locs.size()) + " densities and radii");
+		return MS::kInvalidParameter;
+	}
+
+	// Creating block points moves the others in blockPoints, and builds coverage stencils, so it all happens before gathering
+	handles.assign(locs.size(), BlockPointHandle());
+	for (std::size_t i = 0; i < locs.size(); ++i) {
+
+		Point_Int unitIndex = pointToIndex(locs[i]);
+
+		if (!indicesAreInRange_showError(unitIndex.x, unitIndex.y, unitIndex.z)) {
+
+			status = MS::kFailure;
+			continue;
+		}
+
+		handles[i] = createBlockPoint(locs[i], densities.size() == 1 ? densities[0] : densities[i], radii.size() == 1 ? radii[0] : radii[i], unitIndex);
+	}
+
+	std::vector<const BlockPoint*> newBPs;
+	for (const auto& handle : handles) {
+
+		if (const BlockPoint* bp = blockPoints.get(handle))
+			newBPs.push_back(bp);
+	}
+
+	applyDensityDeltas(gatherDensityDeltas(newBPs.size(), [&](std::size_t i, std::vector<DensityDelta>& deltas) {
+
+		int delta = add * static_cast<int>(newBPs[i]->getDensity());
+		forEachCoveredIndex(*newBPs[i], [&](const Point_Int& index) { deltas.push_back({ Morton::encode(index), delta }); });
+	}));
+
+	return status;
+}
+
+MStatus BlockPointGrid::moveBlockPoints(const std::vector<BlockPointHandle>& handles, const std::vector<MPoint>& newLocs) {
+
+	MStatus status = MS::kSuccess;
+
+	if (handles.size() != newLocs.size()) {
+
+		MGlobal::displayError(MString() + "Expected " + static_cast<unsigned int>(handles.size()) + " locations");
+		return MS::kInvalidParameter;
+	}
+
+	struct Move {
+
+		BlockPoint* bp;
+		Point_Int moveVector;
+		MPoint newLoc;
+	};
+
+	// Moves whose differences are cached have them built here, since stencils build them on first use.  Only the first move of a block
+	// point that is passed more than once is made.
+	std::vector<Move> moves;
+	std::unordered_set<std::uint32_t> slotsSeen;
+	for (std::size_t i = 0; i < handles.size(); ++i) {
+
+		BlockPoint* bp = blockPoints.get(handles[i]);
+		if (!bp || !slotsSeen.insert(handles[i].slot).second)
+			continue;
+
+		Point_Int newUnitIndex = pointToIndex(newLocs[i]);
+
+		if (!indicesAreInRange_showError(newUnitIndex.x, newUnitIndex.y, newUnitIndex.z)) {
+
+			status = MS::kFailure;
+			continue;
+		}
+
+		Point_Int moveVector = newUnitIndex - bp->getGridIndex();
+		bp->getCoverage()->getMoveDifference(moveVector);
+		moves.push_back({ bp, moveVector, newLocs[i] });
+	}
+
+	applyDensityDeltas(gatherDensityDeltas(moves.size(), [&](std::size_t i, std::vector<DensityDelta>& deltas) {
+
+		const Move& move = moves[i];
+		int density = static_cast<int>(move.bp->getDensity());
+
+		if (move.moveVector != Point_Int(0, 0, 0)) {
+
+			move.bp->getCoverage()->forEachMovedIndex(move.bp->getGridIndex(), move.moveVector, xElements, yElements, zElements,
+				[&](const Point_Int& index) { deltas.push_back({ Morton::encode(index), subtract * density }); },
+				[&](const Point_Int& index) { deltas.push_back({ Morton::encode(index), add * density }); });
+		}
+	}));
+
+	for (const auto& move : moves) {
+
+		move.bp->setGridIndex(move.bp->getGridIndex() + move.moveVector);
+		move.bp->setLoc(move.newLoc);
+	}
+
+	return status;
+}
+
+void BlockPointGrid::deleteBlockPoints(const std::vector<BlockPointHandle>& handles) {
+
+	// A handle passed twice is only deleted once
+	std::vector<BlockPointHandle> toDelete;
+	std::unordered_set<std::uint32_t> slotsSeen;
+	for (const auto& handle : handles) {
+
+		if (blockPoints.contains(handle) && slotsSeen.insert(handle.slot).second)
+			toDelete.push_back(handle);
+	}
+
+	applyDensityDeltas(gatherDensityDeltas(toDelete.size(), [&](std::size_t i, std::vector<DensityDelta>& deltas) {
+
+		const BlockPoint& bp = *blockPoints.get(toDelete[i]);
+		int delta = subtract * static_cast<int>(bp.getDensity());
+		forEachCoveredIndex(bp, [&](const Point_Int& index) { deltas.push_back({ Morton::encode(index), delta }); });
+	}));
+
+	for (const auto& handle : toDelete) {
+
+		blockPointIds.erase(blockPoints.get(handle)->getId());
+		blockPoints.erase(handle);
+	}
+}
+
+MStatus BlockPointGrid::addCapsule(const MPoint& start, const MPoint& end, double radius, double density, CapsuleHandle& handle) {
+
+	if (radius <= 0.) {
+
+		MGlobal::displayError(MString() + "Capsule radius must be positive, but was " + radius);
+		return MS::kInvalidParameter;
+	}
+
+	const double startCoords[3] = { start.x, start.y, start.z };
+	const double endCoords[3] = { end.x, end.y, end.z };
+	handle = capsules.emplace(startCoords, endCoords, radius, static_cast<int>(std::round(density)));
+	CapsuleOccluder* capsule = capsules.get(handle);
+
+	MPoint firstCenter = units.center(0, 0, 0);
+	const double firstCenterCoords[3] = { firstCenter.x, firstCenter.y, firstCenter.z };
+	capsule->rasterize(firstCenterCoords, unitSize, xElements, yElements, zElements, capsuleCoverageScratch);
+	capsule->swapCoverage(capsuleCoverageScratch);
+
+	for (const auto& run : capsule->getCoverage())
+		adjustCoverageRun(run.x, run.y, run.zBegin, run.zEnd, add * capsule->getDensity());
+
+	return MS::kSuccess;
+}
+
+MStatus BlockPointGrid::moveCapsule(const CapsuleHandle& handle, const MPoint& newStart, const MPoint& newEnd) {
 
-	blockPoints.push_back(newBP);
-	ptrForSeg = newBP;
+	CapsuleOccluder* capsule = capsules.get(handle);
+	if (!capsule)
+		return MS::kInvalidParameter;
+
+	const double startCoords[3] = { newStart.x, newStart.y, newStart.z };
+	const double endCoords[3] = { newEnd.x, newEnd.y, newEnd.z };
+	capsule->setEndpoints(startCoords, endCoords);
+
+	MPoint firstCenter = units.center(0, 0, 0);
+	const double firstCenterCoords[3] = { firstCenter.x, firstCenter.y, firstCenter.z };
+	capsule->rasterize(firstCenterCoords, unitSize, xElements, yElements, zElements, capsuleCoverageScratch);
+
+	int density = capsule->getDensity();
+	CapsuleOccluder::forEachCoverageDifference(capsule->getCoverage(), capsuleCoverageScratch,
+		[&](int x, int y, int zBegin, int zEnd) { adjustCoverageRun(x, y, zBegin, zEnd, subtract * density); },
+		[&](int x, int y, int zBegin, int zEnd) { adjustCoverageRun(x, y, zBegin, zEnd, add * density); });
+
+	// The old coverage is left in the scratch runs, so their memory is reused by the next move
+	capsule->swapCoverage(capsuleCoverageScratch);
+
+	return MS::kSuccess;
+}
+
+void BlockPointGrid::deleteCapsule(const CapsuleHandle& handle) {
+
+	const CapsuleOccluder* capsule = capsules.get(handle);
+	if (!capsule)
+		return;
+
+	for (const auto& run : capsule->getCoverage())
+		adjustCoverageRun(run.x, run.y, run.zBegin, run.zEnd, subtract * capsule->getDensity());
+
+	capsules.erase(handle);
+}
+
+MStatus BlockPointGrid::addMesh(const std::vector<float>& vertices, const std::vector<std::uint32_t>& indices, double density, bool solid, MeshHandle& handle) {
+
+	if (vertices.size() % 3 != 0 || indices.size() % 3 != 0) {
+
+		MGlobal::displayError("Mesh vertices and indices must both come in threes");
+		return MS::kInvalidParameter;
+	}
+
+	for (float coordinate : vertices) {
+
+		if (!std::isfinite(coordinate)) {
+
+			MGlobal::displayError("Mesh vertices must be finite");
+			return MS::kInvalidParameter;
+		}
+	}
+
+	std::size_t vertexCount = vertices.size() / 3;
+	for (std::uint32_t i : indices) {
+
+		if (i >= vertexCount) {
+
+			MGlobal::displayError(MString() + "Mesh index " + i + " is out of range of its " + static_cast<unsigned int>(vertexCount) + " vertices");
+			return MS::kInvalidParameter;
+		}
+	}
+
+	MPoint firstCenter = units.center(0, 0, 0);
+	const double firstCenterCoords[3] = { firstCenter.x, firstCenter.y, firstCenter.z };
+
+	handle = meshes.emplace();
+	OccluderMesh* mesh = meshes.get(handle);
+	mesh->voxels = MeshVoxelizer::voxelize(vertices, indices, firstCenterCoords, unitSize, xElements, yElements, zElements, solid, threadCount);
+	mesh->density = static_cast<int>(std::round(density));
+	mesh->id = nextOccluderId++;
+	meshIds[mesh->id] = handle;
+
+	int adj = add * mesh->density;
+	mesh->voxels.forEachOccupied([&](int x, int y, int z) { adjustCoverageRun(x, y, z, z + 1, adj); });
+
+	return MS::kSuccess;
+}
+
+void BlockPointGrid::deleteMesh(const MeshHandle& handle) {
+
+	const OccluderMesh* mesh = meshes.get(handle);
+	if (!mesh)
+		return;
+
+	int adj = subtract * mesh->density;
+	mesh->voxels.forEachOccupied([&](int x, int y, int z) { adjustCoverageRun(x, y, z, z + 1, adj); });
+
+	meshIds.erase(mesh->id);
+	meshes.erase(handle);
+}
+
+MStatus BlockPointGrid::addPointCloud(const std::string& path, bool hasRadius, double density, PointCloudHandle& handle) {
+
+	MPoint firstCenter = units.center(0, 0, 0);
+	const double firstCenterCoords[3] = { firstCenter.x, firstCenter.y, firstCenter.z };
+
+	std::vector<BinnedPoint> points;
+	std::string error;
+	if (!PointCloudLoader::load(path, hasRadius, firstCenterCoords, unitSize, xElements, yElements, zElements, threadCount, points, error)) {
+
+		MGlobal::displayError(error.c_str());
+		return MS::kFailure;
+	}
+
+	int delta = add * static_cast<int>(std::round(density));
+	std::vector<DensityDelta> deltas;
+
+	if (!hasRadius) {
+
+		// Binning already left one point per unit
+		deltas.reserve(points.size());
+		for (const auto& point : points)
+			deltas.push_back({ Morton::encode(Point_Int(point.x, point.y, point.z)), delta });
+	}
+	else {
+
+		// The stencil cache isn't thread safe, so stencils are all found before gathering
+		std::vector<const CoverageStencil*> stencils(points.size());
+		for (std::size_t i = 0; i < points.size(); ++i) {
+
+			const BinnedPoint& point = points[i];
+			MVector subUnitOffset(point.subUnitOffset[0], point.subUnitOffset[1], point.subUnitOffset[2]);
+			stencils[i] = coverageStencils.get(point.radius / unitSize, subUnitOffset);
+		}
+
+		deltas = gatherDensityDeltas(points.size(), [&](std::size_t i, std::vector<DensityDelta>& chunkDeltas) {
+
+			Point_Int origin(points[i].x, points[i].y, points[i].z);
+			stencils[i]->forEachIndex(origin, xElements, yElements, zElements,
+				[&](const Point_Int& index) { chunkDeltas.push_back({ Morton::encode(index), 1 }); });
+		});
+
+		// Gathering counted how many points cover each unit, but each unit only gets the density once
+		for (auto& d : deltas)
+			d.delta = delta;
+	}
+
+	if (delta == 0)
+		deltas.clear();
+
+	applyDensityDeltas(deltas);
+
+	handle = pointClouds.emplace();
+	OccluderPointCloud* pointCloud = pointClouds.get(handle);
+	pointCloud->deltas = std::move(deltas);
+	pointCloud->id = nextOccluderId++;
+	pointCloudIds[pointCloud->id] = handle;
+
+	return MS::kSuccess;
+}
+
+void BlockPointGrid::deletePointCloud(const PointCloudHandle& handle) {
+
+	OccluderPointCloud* pointCloud = pointClouds.get(handle);
+	if (!pointCloud)
+		return;
+
+	for (auto& d : pointCloud->deltas)
+		d.delta = -d.delta;
+
+	applyDensityDeltas(pointCloud->deltas);
+
+	pointCloudIds.erase(pointCloud->id);
+	pointClouds.erase(handle);
+}
+
+void BlockPointGrid::adjustCoverageRun(int x, int y, int zBegin, int zEnd, int adj) {
+
+	for (int z = zBegin; z < zEnd; ++z) {
+
+		GridUnit unit = unitAt(x, y, z);
+		unit.adjustDensityIncludingExcess(adj);
+		dirtyDensityUnits.insert(unit.getLinearIndex());
+	}
+}
+
+std::vector<BlockPointGrid::DensityDelta> BlockPointGrid::gatherDensityDeltas(std::size_t count, const std::function<void(std::size_t, std::vector<DensityDelta>&)>& stamp) const {
+
+	std::size_t chunkCount = (count + BLOCK_POINT_CHUNK_SIZE - 1) / BLOCK_POINT_CHUNK_SIZE;
+	std::vector<std::vector<DensityDelta>> chunkDeltas(chunkCount);
+
+	parallelFor(chunkCount, chunkCount > 1 ? threadCount : 1, [&](std::size_t c) {
+
+		std::size_t end = std::min(count, (c + 1) * BLOCK_POINT_CHUNK_SIZE);
+		for (std::size_t i = c * BLOCK_POINT_CHUNK_SIZE; i < end; ++i)
+			stamp(i, chunkDeltas[c]);
+
+		combineDensityDeltas(chunkDeltas[c]);
+	});
+
+	if (chunkCount == 1)
+		return std::move(chunkDeltas[0]);
+
+	std::vector<DensityDelta> deltas;
+	for (const auto& chunk : chunkDeltas)
+		deltas.insert(deltas.end(), chunk.begin(), chunk.end());
+
+	combineDensityDeltas(deltas);
+
+	return deltas;
+}
+
+void BlockPointGrid::combineDensityDeltas(std::vector<DensityDelta>& deltas) {
+
+	std::sort(deltas.begin(), deltas.end(), [](const DensityDelta& lhs, const DensityDelta& rhs) { return lhs.key < rhs.key; });
+
+	std::size_t combined = 0;
+	for (std::size_t i = 0; i < deltas.size();) {
+
+		DensityDelta sum = deltas[i];
+		for (++i; i < deltas.size() && deltas[i].key == sum.key; ++i)
+			sum.delta += deltas[i].delta;
+
+		if (sum.delta != 0)
+			deltas[combined++] = sum;
+	}
+
+	deltas.resize(combined);
+}
+
+void BlockPointGrid::applyDensityDeltas(const std::vector<DensityDelta>& deltas) {
+
+	for (const auto& d : deltas) {
+
+		Point_Int i = Morton::decode(d.key);
+		GridUnit unit = unitAt(i.x, i.y, i.z);
+		unit.adjustDensityIncludingExcess(d.delta);
+		dirtyDensityUnits.insert(unit.getLinearIndex());
+	}
+}
+
+MStatus BlockPointGrid::deleteAllBlockPoints() {
+
+	MStatus status;
+
+	// Delete the bp objects and adjust the grid units they were affecting
+	// Deleting from the back of blockPoints never has to move another bp into the deleted one's place
+	while (!blockPoints.empty())
+
+		deleteBlockPoint(blockPoints.handleAt(blockPoints.size() - 1));
+
+
+	// Delete all child objects of the bpMeshGroup
+	MFnDagNode bpMeshGroupDagNodeFn(bpMeshGroup);
+
+	for (int i = static_cast<int>(bpMeshGroupDagNodeFn.childCount()); i >= 0; --i) {
+		MObject childObj = bpMeshGroupDagNodeFn.child(i);
+		MDagPath childDagPath;
+		MFnDagNode(childObj).getPath(childDagPath);
+
+		MObject childNode = childDagPath.node();
+		MGlobal::deleteNode(childNode);
+	}
+
+
+	return MS::kSuccess;
+}
+
+MStatus BlockPointGrid::applyShade() {
+
+	MStatus status;
+
+	// Pairs of the linear indices of units whose density changed and whether they became dense
+	std::vector<std::pair<std::uint32_t, bool>> changedUnits;
+
+	for (auto i : dirtyDensityUnits) {
+
+		GridUnit u = unitAt(i);
+		u.checkDensity(status);
+
+		int densityChange = u.updateDensity();
+
+		if (std::abs(densityChange) == 0)
+			continue;
+
+		u.setArrowDensityPlug();
+
+		changedUnits.push_back({ i, densityChange > 0 });
+	}
+
+	dirtyDensityUnits.clear();
+
+	// Handle the changes from the top of the grid down so that the order doesn't depend on dirtyDensityUnits' hashing.  Shade always travels
+	// downward or level, so a unit's change is seeded before those of the units it shades.
+	std::sort(changedUnits.begin(), changedUnits.end(), [this](const std::pair<std::uint32_t, bool>& a, const std::pair<std::uint32_t, bool>& b) {
+
+		Point_Int aIndex = units.gridIndex(a.first);
+		Point_Int bIndex = units.gridIndex(b.first);
+
+		if (aIndex.y != bIndex.y)
+			return aIndex.y > bIndex.y;
+		else if (aIndex.x != bIndex.x)
+			return aIndex.x < bIndex.x;
+
+		return aIndex.z < bIndex.z;
+	});
+
+	// A single change is quicker to propagate on its own, since it can use the free field stencil
+	if (changedUnits.size() > 1) {
+
+		status = propagateBatch(changedUnits);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+	}
+	else {
+
+		for (const auto& [i, add] : changedUnits) {
+
+			GridUnit u = unitAt(i);
+			Point_Int dirtyUnitIndex = u.getGridIndex();
+
+			// A change in density made to this unit affects the shade travelling through it, which is represented by appliedShadeIndices.
+			// So, before applying the shade resulting from the density change in this unit, adjust the existing shade accordingly.  If this unit has
+			// become dense, then shade that had been travelling through it is removed. If it has lost density, then shade that it was blocking is put back.
+			for (const auto& [sv, percentage] : u.getAppliedShadeVectors()) {
+
+				status = propagateFrom(sv, dirtyUnitIndex - shadeVectorGraph.toUnits[sv], percentage, !add);
+				CHECK_MSTATUS_AND_RETURN_IT(status);
+			}
+
+			status = propagateFromRoot(dirtyUnitIndex, add);
+			CHECK_MSTATUS_AND_RETURN_IT(status);
+
+			setUnitBlocked(u, add);
+		}
+	}
+
+	updateAllUnitsLightConditions();
+
+	return MS::kSuccess;
+}
+
+MStatus BlockPointGrid::propagateBatch(const std::vector<std::pair<std::uint32_t, bool>>& changedUnits) {
+
+	BatchPropagationScratch& scratch = batchPropagationScratch;
+
+	// Seeds are taken from the applied ShadeVectors as they are before the batch, so every seed is in place before any blocked state changes
+	for (const auto& [i, add] : changedUnits) {
+
+		GridUnit u = unitAt(i);
+		Point_Int unitIndex = u.getGridIndex();
+
+		for (const auto& [sv, percentage] : u.getAppliedShadeVectors())
+			seedBatch(sv, unitIndex - shadeVectorGraph.toUnits[sv], add ? -percentage : percentage, scratch.level(shadeVectorGraph.level(sv) + 1));
+
+		seedBatch(ShadeVectorGraph::ROOT, unitIndex, add ? 1. : -1., scratch.level(1));
+	}
+
+	for (const auto& [i, add] : changedUnits)
+		setUnitBlocked(unitAt(i), add);
+
+	int xTiles = (xElements + PROPAGATION_TILE_SIZE - 1) / PROPAGATION_TILE_SIZE;
+	int zTiles = (zElements + PROPAGATION_TILE_SIZE - 1) / PROPAGATION_TILE_SIZE;
+	scratch.tiles.resize(static_cast<std::size_t>(xTiles) * zTiles);
+
+	for (std::size_t level = 0; level < scratch.levels.size(); ++level) {
+
+		std::vector<BatchRelay>& thisLevel = scratch.levels[level];
+		unsigned int threads = thisLevel.size() < MIN_PARALLEL_RELAYS ? 1 : threadCount;
+
+		for (const auto& relay : thisLevel)
+			scratch.tiles[((relay.x / PROPAGATION_TILE_SIZE) * zTiles) + (relay.z / PROPAGATION_TILE_SIZE)].relays.push_back(relay);
+
+		thisLevel.clear();
+
+		parallelFor(scratch.tiles.size(), threads, [&](std::size_t t) { mergeAndExpandTile(scratch.tiles[t]); });
+
+		// Apply the tiles' shade in tile order.  Only this thread touches the units.
+		for (auto& tile : scratch.tiles) {
+
+			for (const auto& relay : tile.merged) {
+
+				GridUnit unit = unitAt(relay.x, relay.y, relay.z);
+				SvRelay unsignedRelay = { relay.sv, std::abs(relay.cumulativePercentage) };
+
+				if (relay.cumulativePercentage > 0.) {
+
+					unit.applyShadeVector(&unsignedRelay, shadeVectorGraph);
+				}
+				else {
+
+					unit.unapplyShadeVector(&unsignedRelay, shadeVectorGraph);
+				}
+
+				dirtyUnits.insert(unit.getLinearIndex());
+			}
+
+			if (!tile.children.empty()) {
+
+				std::vector<BatchRelay>& nextLevel = scratch.level(level + 1);
+				nextLevel.insert(nextLevel.end(), tile.children.begin(), tile.children.end());
+			}
+
+			tile.relays.clear();
+			tile.merged.clear();
+			tile.children.clear();
+		}
+	}
+
+	return MS::kSuccess;
+}
+
+void BlockPointGrid::mergeAndExpandTile(BatchTile& tile) const {
+
+	tile.slotsByKey.clear();
+
+	// Merge the relays that reach the same unit through the same ShadeVector
+	for (const auto& relay : tile.relays) {
+
+		std::uint64_t unitKey = (((static_cast<std::uint64_t>(relay.x) * yElements) + relay.y) * zElements) + relay.z;
+		std::uint64_t key = (unitKey << 32) | relay.sv;
+
+		const auto it = tile.slotsByKey.find(key);
+		if (it == tile.slotsByKey.end()) {
+
+			tile.slotsByKey.insert({ key, static_cast<std::uint32_t>(tile.merged.size()) });
+			tile.merged.push_back(relay);
+		}
+		else {
+
+			tile.merged[it->second].cumulativePercentage += relay.cumulativePercentage;
+			tile.merged[it->second].magnitude += relay.magnitude;
+		}
+	}
 
-	auto indicesInRadius = getIndicesInRadius(loc, newBP->getGridIndex(), bpRadius);
-	newBP->setIndicesInRadius(indicesInRadius);
+	// Shade that is added and removed in the same batch cancels out, apart from rounding, and goes no further
+	tile.merged.erase(std::remove_if(tile.merged.begin(), tile.merged.end(), [](const BatchRelay& relay) {
+		return std::abs(relay.cumulativePercentage) <= CANCELLED_RELAY_TOLERANCE * relay.magnitude; }), tile.merged.end());
 
-	for (const auto& i : indicesInRadius) {
+	// Apply the relays in Morton order of their units so that the units are visited mostly in the order they are stored.  Relays for the same
+	// unit keep the order they were merged in.
+	tile.sortKeys.clear();
+	for (std::uint32_t r = 0; r < tile.merged.size(); ++r) {
 
-		GridUnit* unit = &grid[i.x][i.y][i.z];
-		unit->adjustDensityIncludingExcess(add * static_cast<int>(std::round(bpDensity)));
-		dirtyDensityUnits.insert(unit);
+		const BatchRelay& relay = tile.merged[r];
+		tile.sortKeys.push_back({ Morton::encode(relay.x, relay.y, relay.z), r });
 	}
 
-	return MS::kSuccess;
-}
-
-MStatus BlockPointGrid::moveBlockPoint(BlockPoint& bp, const MPoint newLoc) {
+	std::sort(tile.sortKeys.begin(), tile.sortKeys.end());
 
-	MStatus status;
+	tile.sorted.clear();
+	for (const auto& [key, r] : tile.sortKeys)
+		tile.sorted.push_back(tile.merged[r]);
 
-	Point_Int newUnitIndex = pointToIndex(newLoc);
+	tile.merged.swap(tile.sorted);
 
-	if (!indicesAreInRange_showError(newUnitIndex.x, newUnitIndex.y, newUnitIndex.z))
-		return MS::kFailure;
+	// Blocked states don't change while the batch propagates, so the children can be found before any shade is applied
+	for (const auto& relay : tile.merged) {
 
-	Point_Int bpGridIndex = bp.getGridIndex();
-	if (newUnitIndex != bpGridIndex) {
+		if (!units.isBlocked(relay.x, relay.y, relay.z))
+			seedBatch(relay.sv, Point_Int(relay.x, relay.y, relay.z) - shadeVectorGraph.toUnits[relay.sv], relay.cumulativePercentage, tile.children);
+	}
+}
 
-		// Since BlockPoints' radius allows them to affect many units, we must add its movement to the set of indices in its radius, then figure out which of the resulting
-		// indices were not in the original set (this results in newSetDiff), as well as which ones in the original set are not in the new set (this results in oldSetDiff).
-		// Only the units within these set differences have changed densities, so only they are used to adjust the grid.
+void BlockPointGrid::seedBatch(ShadeVectorGraph::Index sv, const Point_Int& origin, double percentage, std::vector<BatchRelay>& relays) const {
 
-		std::vector<Point_Int> newSetDiff;
-		std::vector<Point_Int> oldSetDiff;
-		Point_Int moveVector = newUnitIndex - bpGridIndex;
-		status = addMoveVectorToBP(bp, moveVector, newSetDiff, oldSetDiff);
-		CHECK_MSTATUS_AND_RETURN_IT(status);
-		bp.setGridIndex(newUnitIndex);
+	for (ShadeVectorGraph::Index c = shadeVectorGraph.childOffsets[sv]; c < shadeVectorGraph.childOffsets[sv + 1]; ++c) {
 
-		for (auto& i : oldSetDiff) {
+		ShadeVectorGraph::Index child = shadeVectorGraph.childIndices[c];
+		const Point_Int& toUnit = shadeVectorGraph.toUnits[child];
 
-			GridUnit* unit = &grid[i.x][i.y][i.z];
-			unit->adjustDensityIncludingExcess(subtract * bp.getDensity());
-			dirtyDensityUnits.insert(unit);
-		}
+		int X = origin.x + toUnit.x;
+		int Y = origin.y + toUnit.y;
+		int Z = origin.z + toUnit.z;
 
-		for (auto& i : newSetDiff) {
+		// Everything beyond a unit that is off of the grid is off of it as well
+		if (!indicesAreOnGrid(X, Y, Z))
+			continue;
 
-			GridUnit* unit = &grid[i.x][i.y][i.z];
-			unit->adjustDensityIncludingExcess(add * bp.getDensity());
-			dirtyDensityUnits.insert(unit);
-		}
+		double childPercentage = shadeVectorGraph.percentShared[c] * percentage;
+		relays.push_back({ X, Y, Z, child, childPercentage, std::abs(childPercentage) });
 	}
+}
 
-	// set the new location for the block point
-	bp.setLoc(newLoc);
+MStatus BlockPointGrid::propagateFrom(ShadeVectorGraph::Index startShadeVector, Point_Int blockerIndex, double startingPercentage, bool add) {
 
-	return MS::kSuccess;
-}
+	MStatus status;
 
-void BlockPointGrid::deleteBlockPoint(std::shared_ptr<BlockPoint> bp) {
+	PropagationScratch& scratch = propagationScratch;
+	scratch.prepare(shadeVectorGraph.size());
+	scratch.nextLevel.clear();
 
-	// remove the bp's effect on the grid
-	for (const auto& i : bp->getIndicesInRadius()) {
+	for (ShadeVectorGraph::Index c = shadeVectorGraph.childOffsets[startShadeVector]; c < shadeVectorGraph.childOffsets[startShadeVector + 1]; ++c)
+		scratch.nextLevel.push_back({ shadeVectorGraph.childIndices[c], shadeVectorGraph.percentShared[c] * startingPercentage });
 
-		GridUnit* unit = &grid[i.x][i.y][i.z];
-		unit->adjustDensityIncludingExcess(subtract * bp->getDensity());
-		dirtyDensityUnits.insert(unit);
-	}
+	scratch.advanceLevel();
 
-	// remove the bpg's handle to the bp
-	blockPoints.erase(remove(blockPoints.begin(), blockPoints.end(), bp), blockPoints.end());
-}
+	while (!scratch.thisLevel.empty()) {
 
-MStatus BlockPointGrid::deleteAllBlockPoints() {
+		for (auto& relay : scratch.thisLevel) {
 
-	MStatus status;
+			const Point_Int& toUnit = shadeVectorGraph.toUnits[relay.sv];
 
-	// Delete the bp objects and adjust the grid units they were affecting
-	// Since deleteBlockPoint will change the size of blockPoints, loop through a copy
-	std::vector<std::shared_ptr<BlockPoint>> bpsCopy = blockPoints;
-	for (auto& bp : bpsCopy)
+			int X = blockerIndex.x + toUnit.x;
+			int Y = blockerIndex.y + toUnit.y;
+			int Z = blockerIndex.z + toUnit.z;
 
-		deleteBlockPoint(bp);
+			if (indicesAreOnGrid(X, Y, Z)) {
 
+				GridUnit unit = unitAt(X, Y, Z);
 
-	// Delete all child objects of the bpMeshGroup
-	MFnDagNode bpMeshGroupDagNodeFn(bpMeshGroup);
+				if (add) {
 
-	for (int i = static_cast<int>(bpMeshGroupDagNodeFn.childCount()); i >= 0; --i) {
-		MObject childObj = bpMeshGroupDagNodeFn.child(i);
-		MDagPath childDagPath;
-		MFnDagNode(childObj).getPath(childDagPath);
+					unit.applyShadeVector(&relay, shadeVectorGraph);
+				}
+				else {
 
-		MObject childNode = childDagPath.node();
-		MGlobal::deleteNode(childNode);
-	}
+					unit.unapplyShadeVector(&relay, shadeVectorGraph);
+				}
+
+				if (!unit.isBlocked()) {
+					shadeVectorGraph.getChildren(relay.sv, relay.cumulativePercentage, scratch);
+				}
+
+				dirtyUnits.insert(unit.getLinearIndex());
+			}
+		}
 
+		scratch.advanceLevel();
+	}
 
 	return MS::kSuccess;
 }
 
-MStatus BlockPointGrid::applyShade() {
+MStatus BlockPointGrid::propagateFromRoot(const Point_Int& blockerIndex, bool add) {
 
-	MStatus status;
+	if (!freeFieldIsClear(blockerIndex))
+		return propagateFrom(ShadeVectorGraph::ROOT, blockerIndex, 1., add);
 
-	for (auto& u : dirtyDensityUnits) {
+	// Nothing can stop the shade, so every unit in the stencil gets exactly what propagateFrom would have given it.  Units off of the grid are
+	// skipped, which matches propagateFrom since everything beyond a unit off of the grid is off of it as well.
+	for (const auto& relay : shadeVectorGraph.freeFieldStencil) {
 
-		u->checkDensity(status);
+		const Point_Int& toUnit = shadeVectorGraph.toUnits[relay.sv];
 
-		int densityChange = u->updateDensity();
+		int X = blockerIndex.x + toUnit.x;
+		int Y = blockerIndex.y + toUnit.y;
+		int Z = blockerIndex.z + toUnit.z;
 
-		if (std::abs(densityChange) == 0)
+		if (!indicesAreOnGrid(X, Y, Z))
 			continue;
 
-		u->setArrowDensityPlug();
+		GridUnit unit = unitAt(X, Y, Z);
 
-		bool add = densityChange > 0;
-		Point_Int dirtyUnitIndex = u->getGridIndex();
+		if (add) {
 
-		// A change in density made to this unit affects the shade travelling through it, which is represented by appliedShadeIndices.
-		// So, before applying the shade resulting from the density change in this unit, adjust the existing shade accordingly.  If this unit has
-		// become dense, then shade that had been travelling through it is removed. If it has lost density, then shade that it was blocking is put back.
-		for (const auto& [sv, percentage] : u->getAppliedShadeVectors()) {
-			//if (u->xIndex == 16 && u->zIndex == 16 && (u->yIndex < 5 && u->yIndex > 0)) {
-			//MString action = add ? "Removing" : "Putting back";
-			//MGlobal::displayInfo(MString() + action + " below occupant: " + occupant.first->toUnit.toMString());
-
-			status = propagateFrom(sv, dirtyUnitIndex - sv->toUnit, percentage, !add);
-			CHECK_MSTATUS_AND_RETURN_IT(status);
+			unit.applyShadeVector(&relay, shadeVectorGraph);
 		}
+		else {
 
-		status = propagateFrom(shadeRoot.get(), dirtyUnitIndex, 1., add);
-		CHECK_MSTATUS_AND_RETURN_IT(status);
+			unit.unapplyShadeVector(&relay, shadeVectorGraph);
+		}
 
-		u->setBlocked(add);
+		dirtyUnits.insert(unit.getLinearIndex());
 	}
 
-	dirtyDensityUnits.clear();
-	updateAllUnitsLightConditions();
-
 	return MS::kSuccess;
 }
 
-MStatus BlockPointGrid::propagateFrom(ShadeVector* startShadeVector, Point_Int blockerIndex, double startingPercentage, bool add) {
+bool BlockPointGrid::freeFieldIsClear(const Point_Int& blockerIndex) const {
 
-	MStatus status;
+	const Point_Int& stencilMin = shadeVectorGraph.stencilMin;
+	const Point_Int& stencilMax = shadeVectorGraph.stencilMax;
 
-	std::vector<SvRelay> thisLevel;
-	for (auto& n : startShadeVector->neighborShadeVectors)
-		thisLevel.push_back({ n.neighbor.get(), n.percentShared * startingPercentage });
+	int xMin = std::max(blockerIndex.x + stencilMin.x, 0) / OCCUPANCY_CELL_SIZE;
+	int yMin = std::max(blockerIndex.y + stencilMin.y, 0) / OCCUPANCY_CELL_SIZE;
+	int zMin = std::max(blockerIndex.z + stencilMin.z, 0) / OCCUPANCY_CELL_SIZE;
+	int xMax = std::min(blockerIndex.x + stencilMax.x, xElements - 1) / OCCUPANCY_CELL_SIZE;
+	int yMax = std::min(blockerIndex.y + stencilMax.y, yElements - 1) / OCCUPANCY_CELL_SIZE;
+	int zMax = std::min(blockerIndex.z + stencilMax.z, zElements - 1) / OCCUPANCY_CELL_SIZE;
 
-	// encountered keeps track of which ShadeVectors have been added to thisLevel so that we can keep them unique.  It also records the position
-	// of each in thisLevel so that we can quickly access and modify them when needed.
-	std::unordered_map<std::shared_ptr<ShadeVector>, std::size_t> encountered;
+	// The cells cover at least the stencil's bounds, which always include the blocker, so it is discounted if it is blocked
+	int blockedUnits = units.isBlocked(blockerIndex.x, blockerIndex.y, blockerIndex.z) ? -1 : 0;
 
-	while (!thisLevel.empty()) {
+	for (int xI = xMin; xI <= xMax; ++xI) {
+		for (int yI = yMin; yI <= yMax; ++yI) {
+			for (int zI = zMin; zI <= zMax; ++zI) {
 
-		std::vector<SvRelay> nextLevel;
+				blockedUnits += blockedUnitsByCell[(((static_cast<std::size_t>(xI) * yCells) + yI) * zCells) + zI];
+				if (blockedUnits > 0)
+					return false;
+			}
+		}
+	}
 
-		for (auto& relay : thisLevel) {
+	return true;
+}
 
-			ShadeVector& next = *relay.sv;
+void BlockPointGrid::setUnitBlocked(GridUnit unit, bool blocked) {
 
-			int X = blockerIndex.x + next.toUnit.x;
-			int Y = blockerIndex.y + next.toUnit.y;
-			int Z = blockerIndex.z + next.toUnit.z;
+	if (unit.isBlocked() == blocked)
+		return;
 
-			if (indicesAreOnGrid(X, Y, Z)) {
+	unit.setBlocked(blocked);
 
-				GridUnit& unit = grid[X][Y][Z];
+	Point_Int index = unit.getGridIndex();
+	std::size_t cell = (((static_cast<std::size_t>(index.x / OCCUPANCY_CELL_SIZE) * yCells) + (index.y / OCCUPANCY_CELL_SIZE)) * zCells) + (index.z / OCCUPANCY_CELL_SIZE);
+	blockedUnitsByCell[cell] += blocked ? 1 : -1;
+}
 
-				if (add) {
+void BlockPointGrid::updateAllUnitsLightConditions() {
 
-					unit.applyShadeVector(&relay);
-				}
-				else {
+	if (lazyLightConditions) {
 
-					unit.unapplyShadeVector(&relay);
-				}
+		// Units with meshes, and any unit while shaded units or their arrows are displayed, are shown as soon as they change, so only the rest wait
+		std::vector<std::uint32_t> displayed;
+		for (auto i : dirtyUnits) {
 
-				if (!unit.isBlocked()) {
-					next.getNeighbors(nextLevel, encountered, relay.cumulativePercentage);
-				}
+			markLightStale(i);
 
-				dirtyUnits.insert(&unit);
-			}
+			if (displayShadedUnits || displayShadedUnitArrows || units.findDisplay(i))
+				displayed.push_back(i);
 		}
 
-		thisLevel = std::move(nextLevel);
-		encountered.clear();
+		evaluateStaleUnits(displayed);
+
+		for (auto i : displayed) {
+
+			GridUnit unit = unitAt(i);
+			updateUnitDisplay(unit);
+		}
+
+		dirtyUnits.clear();
+		return;
 	}
 
-	return MS::kSuccess;
-}
+	for (auto i : dirtyUnits) {
 
-void BlockPointGrid::updateAllUnitsLightConditions() {
+		GridUnit unit = unitAt(i);
+		unit.updateLightConditions(intensity, maxVolumeBlocked, unblockedLightDirection);
 
-	for (auto& unit : dirtyUnits) {
+		updateUnitDisplay(unit);
+	}
 
-		unit->updateLightConditions(intensity, maxVolumeBlocked, unblockedLightDirection);
+	dirtyUnits.clear();
+}
 
-		displayAffectedUnitArrowIf(*unit);
+void BlockPointGrid::updateUnitDisplay(GridUnit& unit) {
 
-		if (!displayShadedUnitArrows && unit->arrowMeshIsVisible()) {
+	displayAffectedUnitArrowIf(unit);
 
-			unit->updateArrowMesh();
-			unit->setArrowShadePlug();
-		}
+	if (!displayShadedUnitArrows && unit.arrowMeshIsVisible()) {
 
-		displayShadedUnitIf(*unit);
+		unit.updateArrowMesh();
+		unit.setArrowShadePlug();
 	}
 
-	dirtyUnits.clear();
+	displayShadedUnitIf(unit);
 }
 
 inline bool BlockPointGrid::indicesAreOnGrid(int x, int y, int z) const {
@@ -460,36 +1300,23 @@ inline bool BlockPointGrid::indicesAreInRange_showError(int x, int y, int z) con
 	return true;
 }
 
-MStatus BlockPointGrid::addMoveVectorToBP(BlockPoint& bp, const Point_Int& moveVector, std::vector<Point_Int>& newSetDiff, std::vector<Point_Int>& oldSetDiff) {
-
-	std::unordered_set<Point_Int, Point_Int::HashFunction> newIndicesInRadius;
-	auto oldIndicesInRadius = bp.getIndicesInRadius();
-	for (const auto& i : oldIndicesInRadius) {
-		newIndicesInRadius.insert(i + moveVector);
-	}
-
-	for (const auto& i : oldIndicesInRadius) {
+void BlockPointGrid::addMoveVectorToBP(const BlockPoint& bp, const Point_Int& moveVector) {
 
-		if (newIndicesInRadius.find(i) == newIndicesInRadius.end()) {
+	int bpDensity = static_cast<int>(bp.getDensity());
 
-			oldSetDiff.push_back(i);
-		}
-	}
-
-	for (auto& i : newIndicesInRadius) {
-
-		if (oldIndicesInRadius.find(i) == oldIndicesInRadius.end()) {
-
-			if (!indicesAreInRange_showError(i.x, i.y, i.z))
-				return MS::kFailure;
-
-			newSetDiff.push_back(i);
-		}
-	}
+	bp.getCoverage()->forEachMovedIndex(bp.getGridIndex(), moveVector, xElements, yElements, zElements,
+		[&](const Point_Int& i) {
 
-	bp.setIndicesInRadius(newIndicesInRadius);
+			GridUnit unit = unitAt(i.x, i.y, i.z);
+			unit.adjustDensityIncludingExcess(subtract * bpDensity);
+			dirtyDensityUnits.insert(unit.getLinearIndex());
+		},
+		[&](const Point_Int& i) {
 
-	return MS::kSuccess;
+			GridUnit unit = unitAt(i.x, i.y, i.z);
+			unit.adjustDensityIncludingExcess(add * bpDensity);
+			dirtyDensityUnits.insert(unit.getLinearIndex());
+		});
 }
 
 void BlockPointGrid::traverseRange(Point_Int startInd, Point_Int endInd, std::function<void(GridUnit&)> func) {
@@ -501,7 +1328,13 @@ void BlockPointGrid::traverseRange(Point_Int startInd, Point_Int endInd, std::fu
 				if (!indicesAreOnGrid(x, y, z))
 					continue;
 
-				func(grid[x][y][z]);
+				// Units that haven't been allocated have nothing to visit
+				std::uint32_t i = units.findLinearIndex(x, y, z);
+				if (i == GridUnitStore::NO_UNIT)
+					continue;
+
+				GridUnit unit = unitAt(i);
+				func(unit);
 			}
 		}
 	}
@@ -541,17 +1374,18 @@ double BlockPointGrid::getIntersectionWithShadeRange(const MVector& vectorToUnit
 	return intersectionVolume;
 }
 
-void BlockPointGrid::findAllShadeVectorSubdivisions(std::unordered_map< ShadeVector*, std::vector<MVector>>& subdivisionsByUnit,
-	std::unordered_map<ShadeVector*, std::vector<MVector>>& totalOccludedVolumesByShadeVectors, double subdivisionVolume, double timesToSubDivide) {
+void BlockPointGrid::findAllShadeVectorSubdivisions(std::unordered_map<Point_Int, std::vector<Subdivision>, Point_Int::HashFunction>& canonicalSubdivisions,
+	std::unordered_map<ShadeVector*, std::vector<Subdivision>>& totalOccludedVolumesByShadeVectors, std::vector<ShadeVector*>& allShadeVectors,
+	double minSubdivisionSize) {
 
 	int subdivisionCount = 0;
 
-	std::vector<MVector> rootSubDivisionsInRange = getSubDivisionsInShadeRange({ 0.,0.,0. }, timesToSubDivide);
-	shadeRoot->volumeInRange = rootSubDivisionsInRange.size() * subdivisionVolume;
+	const std::vector<Subdivision>& rootSubDivisionsInRange = getCanonicalSubdivisionsInShadeRange(Point_Int(0, 0, 0), minSubdivisionSize, canonicalSubdivisions);
+	shadeRoot->volumeInRange = getTotalVolume(rootSubDivisionsInRange);
 	MGlobal::displayInfo(MString() + "shadeRoot volumeInRange: " + shadeRoot->volumeInRange);
 
-	subdivisionsByUnit[shadeRoot.get()] = rootSubDivisionsInRange;
 	totalOccludedVolumesByShadeVectors[shadeRoot.get()] = rootSubDivisionsInRange;
+	allShadeVectors.push_back(shadeRoot.get());
 
 	std::queue<std::shared_ptr<ShadeVector>> shadeVectors;
 	shadeVectors.push(shadeRoot);
@@ -571,18 +1405,22 @@ void BlockPointGrid::findAllShadeVectorSubdivisions(std::unordered_map< ShadeVec
 			if (encounteredShadeVectors.find(neighborIndex) == encounteredShadeVectors.end()) {
 
 				encounteredShadeVectors[neighborIndex] = nullptr; // Mark encountered even the indices out of range so we don't have to redundantly check them
-				MVector fullVectorToNeighbor = neighborIndex.toMVector() * unitSize;
-				std::vector<MVector> subDivisionsInRange = getSubDivisionsInShadeRange(fullVectorToNeighbor, timesToSubDivide);
+				// Mirroring doesn't change the volume, so the canonical counterpart's subdivisions are enough to tell if the unit is in range
+				const std::vector<Subdivision>& subDivisionsInRange = getCanonicalSubdivisionsInShadeRange(neighborIndex, minSubdivisionSize, canonicalSubdivisions);
+				double volumeInRange = getTotalVolume(subDivisionsInRange);
 
-				if (subDivisionsInRange.size() * subdivisionVolume > unitVolume * .001) {
+				if (volumeInRange > unitVolume * .001) {
 
 					std::shared_ptr<ShadeVector> newShadeVector = std::make_shared<ShadeVector>(neighborIndex);
 
-					subdivisionsByUnit[newShadeVector.get()] = subDivisionsInRange;
-					totalOccludedVolumesByShadeVectors[newShadeVector.get()] = subDivisionsInRange;
+					// Only canonical ShadeVectors have their occluded volumes computed
+					if (XZSymmetry::isCanonical(neighborIndex))
+						totalOccludedVolumesByShadeVectors[newShadeVector.get()] = subDivisionsInRange;
+
 					shadeVectors.push(newShadeVector);
+					allShadeVectors.push_back(newShadeVector.get());
 					encounteredShadeVectors[neighborIndex] = newShadeVector;
-					newShadeVector->volumeInRange = subDivisionsInRange.size() * subdivisionVolume;
+					newShadeVector->volumeInRange = volumeInRange;
 					/*MGlobal::displayInfo(MString() + "Added new ShadeVector at " + neighborIndex.toMString() + ". subDivisionsInRange: " + subDivisionsInRange.size()
 						+ ", volumeInRange: " + newShadeVector->volumeInRange);*/
 				}
@@ -604,34 +1442,74 @@ void BlockPointGrid::findAllShadeVectorSubdivisions(std::unordered_map< ShadeVec
 	}
 }
 
-void BlockPointGrid::findAllShadedVolume(ShadeVector* shadeVector,
-	std::unordered_map< ShadeVector*, std::vector<MVector>>& subdivisionsByUnit,
-	std::unordered_map<ShadeVector*, std::vector<MVector>>& totalOccludedVolumesByShadeVectors,
-	std::unordered_set<ShadeVector*>& done, double subdivisionVolume, double subdivisionSize) {
+void BlockPointGrid::findAllShadedVolume(const std::vector<ShadeVector*>& allShadeVectors,
+	const std::unordered_map<Point_Int, std::vector<Subdivision>, Point_Int::HashFunction>& canonicalSubdivisions,
+	std::unordered_map<ShadeVector*, std::vector<Subdivision>>& totalOccludedVolumesByShadeVectors, double minSubdivisionSize) {
 
-	if (done.find(shadeVector) != done.end())
-		return;
+	// The graph is unchanged by mirroring x or z or by swapping them, so only the ShadeVectors in the canonical octant (0 <= z <= x) are computed.
+	// Every other ShadeVector copies its values from its canonical counterpart.
+	std::vector<ShadeVector*> canonicalShadeVectors;
+	std::unordered_map<Point_Int, ShadeVector*, Point_Int::HashFunction> shadeVectorsByToUnit;
+	for (ShadeVector* shadeVector : allShadeVectors) {
 
-	//MGlobal::displayInfo(MString() + "In findAllShadedVolume3 for " + shadeVector->toUnit.toMString());
-	for (auto& neighbor : shadeVector->neighborShadeVectors) {
-		//MGlobal::displayInfo(MString() + "checking neighbor: " + neighbor.neighbor->toUnit.toMString());
-		findAllShadedVolume(neighbor.neighbor.get(), subdivisionsByUnit, totalOccludedVolumesByShadeVectors, done,
-			subdivisionVolume, subdivisionSize);
+		shadeVectorsByToUnit[shadeVector->toUnit] = shadeVector;
+		if (XZSymmetry::isCanonical(shadeVector->toUnit))
+			canonicalShadeVectors.push_back(shadeVector);
+	}
+
+	MGlobal::displayInfo(MString() + "Computing " + (unsigned int)canonicalShadeVectors.size() + " of " + (unsigned int)allShadeVectors.size()
+		+ " ShadeVectors, the rest are mirrored");
+
+	// Once the topology and subdivisions exist, the volume each ShadeVector blocks depends only on its own unit and its descendants' subdivisions,
+	// so every ShadeVector can be computed independently.  Each task only writes to its own ShadeVector and its own entry of totalOccludedVolumesByShadeVectors.
+	parallelFor(canonicalShadeVectors.size(), threadCount, [&](std::size_t i) {
+
+		ShadeVector* shadeVector = canonicalShadeVectors[i];
+		computeVolumeBlocked(shadeVector, canonicalSubdivisions, totalOccludedVolumesByShadeVectors.at(shadeVector), minSubdivisionSize);
+	});
+
+	for (ShadeVector* shadeVector : allShadeVectors) {
+
+		if (!XZSymmetry::isCanonical(shadeVector->toUnit)) {
+
+			const ShadeVector* canonical = shadeVectorsByToUnit.at(XZSymmetry::toCanonical(shadeVector->toUnit).apply(shadeVector->toUnit));
+			shadeVector->volumeBlocked = canonical->volumeBlocked;
+			shadeVector->shadeVector = shadeVector->toUnit.toMVector().normal() * shadeVector->volumeBlocked;
+		}
+	}
+
+	// The shared volumes need the complete occluded volume of each child, so they can only be found after all of the above has finished
+	parallelFor(canonicalShadeVectors.size(), threadCount, [&](std::size_t i) {
+
+		computeVolumeSharedWithNeighbors(canonicalShadeVectors[i], shadeVectorsByToUnit, totalOccludedVolumesByShadeVectors, minSubdivisionSize);
+	});
+
+	for (ShadeVector* shadeVector : allShadeVectors) {
+
+		if (!XZSymmetry::isCanonical(shadeVector->toUnit))
+			copySharedVolumeFromCanonical(shadeVector, shadeVectorsByToUnit);
 	}
 
-	//MGlobal::displayInfo(MString() + "Computing volume blocked for " + shadeVector->toUnit.toMString());
+	maxVolumeBlocked = shadeRoot->volumeBlocked;
+}
+
+void BlockPointGrid::computeVolumeBlocked(ShadeVector* shadeVector, const std::unordered_map<Point_Int, std::vector<Subdivision>, Point_Int::HashFunction>& canonicalSubdivisions,
+	std::vector<Subdivision>& occludedSubdivisions, double minSubdivisionSize) const {
 
 	shadeVector->volumeBlocked += shadeVector->volumeInRange;
 
 	std::queue<ShadeVector*> extendedNeighbors;
 	std::unordered_set<ShadeVector*> neighborsEncountered;
-	std::vector<std::pair<MVector, MVector>> unitSidesFacingOrigin = getUnitSidesFacingShadeOrigin(*shadeVector);
+	FacingSides unitSidesFacingOrigin = getUnitSidesFacingShadeOrigin(shadeVector->toUnit);
+
+	// Holds the subdivisions of the neighbor being tested when they have to be mirrored from its canonical counterpart's
+	std::vector<Subdivision> mirroredSubdivisions;
 
 	// Find the portions of the ShadeVector's adjacent units that lie in the frustrum beyond its unit
 	for (auto& shared : shadeVector->neighborShadeVectors) {
 
-		shadeVector->volumeBlocked += computeShadedVolume(unitSidesFacingOrigin, subdivisionsByUnit[shared.neighbor.get()],
-			totalOccludedVolumesByShadeVectors[shadeVector], subdivisionSize, subdivisionVolume);
+		shadeVector->volumeBlocked += computeShadedVolumeOfUnit(shadeVector->toUnit, unitSidesFacingOrigin, shared.neighbor->toUnit,
+			canonicalSubdivisions, mirroredSubdivisions, occludedSubdivisions, minSubdivisionSize);
 
 		extendedNeighbors.push(shared.neighbor.get());
 		neighborsEncountered.insert(shared.neighbor.get());
@@ -647,8 +1525,8 @@ void BlockPointGrid::findAllShadedVolume(ShadeVector* shadeVector,
 
 			if (neighborsEncountered.find(neighbor.neighbor.get()) == neighborsEncountered.end()) {
 
-				shadeVector->volumeBlocked += computeShadedVolume(unitSidesFacingOrigin, subdivisionsByUnit[neighbor.neighbor.get()],
-					totalOccludedVolumesByShadeVectors[shadeVector], subdivisionSize, subdivisionVolume);
+				shadeVector->volumeBlocked += computeShadedVolumeOfUnit(shadeVector->toUnit, unitSidesFacingOrigin, neighbor.neighbor->toUnit,
+					canonicalSubdivisions, mirroredSubdivisions, occludedSubdivisions, minSubdivisionSize);
 
 				extendedNeighbors.push(neighbor.neighbor.get());
 				neighborsEncountered.insert(neighbor.neighbor.get());
@@ -658,78 +1536,174 @@ void BlockPointGrid::findAllShadedVolume(ShadeVector* shadeVector,
 
 	// The length of the actual shadeVector is equal to the volumeBlocked of the ShadeVector node.  Once that has been calculated we can set the vector
 	shadeVector->shadeVector = shadeVector->toUnit.toMVector().normal() * shadeVector->volumeBlocked;
+}
 
-	for (auto& neighbor : shadeVector->neighborShadeVectors) {
+double BlockPointGrid::computeShadedVolumeOfUnit(const Point_Int& blockerToUnit, const FacingSides& blockerUnitSidesFacingOrigin, const Point_Int& toUnit,
+	const std::unordered_map<Point_Int, std::vector<Subdivision>, Point_Int::HashFunction>& canonicalSubdivisions, std::vector<Subdivision>& mirroredSubdivisions,
+	std::vector<Subdivision>& subdivisionsInVolume, const double minSubdivisionSize) const {
 
-		neighbor.sharedBlockage = findVolumeSharedWithNeighbor(unitSidesFacingOrigin, totalOccludedVolumesByShadeVectors[neighbor.neighbor.get()],
-			subdivisionSize, subdivisionVolume);
+	frustumOverlap overlap = getUnitOverlapWithFrustum(blockerToUnit, blockerUnitSidesFacingOrigin, toUnit);
+	if (overlap == outsideFrustum)
+		return 0.;
 
-		neighbor.percentShared = neighbor.sharedBlockage / neighbor.neighbor->volumeBlocked;
+	const std::vector<Subdivision>& unitSubdivisions = getSymmetricSubdivisionsInShadeRange(toUnit, canonicalSubdivisions, mirroredSubdivisions);
+
+	switch (overlap) {
+
+	case insideFrustum:
+		subdivisionsInVolume.insert(subdivisionsInVolume.end(), unitSubdivisions.begin(), unitSubdivisions.end());
+		return getTotalVolume(unitSubdivisions);
+
+	default:
+		return computeShadedVolume(blockerUnitSidesFacingOrigin, unitSubdivisions, subdivisionsInVolume, minSubdivisionSize);
+	}
+}
+
+BlockPointGrid::frustumOverlap BlockPointGrid::getUnitOverlapWithFrustum(const Point_Int& blockerToUnit, const FacingSides& blockerUnitSidesFacingOrigin,
+	const Point_Int& toUnit) const {
+
+	/*
+		Bound both units with spheres, which are seen from the shade origin as cones around the directions to the units' centers.  If those cones don't
+		overlap, no ray through the unit can reach the blocker.  The spheres are sized for the blocker's sides including their edge tolerance.
+		The shadeRoot's frustrum surrounds the origin, so this only applies to other blockers.
+	*/
+	MVector blockerCenter = blockerToUnit.toMVector() * unitSize;
+	MVector unitCenter = toUnit.toMVector() * unitSize;
+	double boundingRadius = blockerUnitSidesFacingOrigin.halfWidth * std::sqrt(3.);
+	double blockerDistance = blockerCenter.length();
+	double unitDistance = unitCenter.length();
+
+	if (blockerDistance > boundingRadius && unitDistance > boundingRadius) {
+
+		double separation = blockerCenter.angle(unitCenter);
+		if (separation > std::asin(boundingRadius / blockerDistance) + std::asin(boundingRadius / unitDistance))
+			return outsideFrustum;
 	}
 
-	if (shadeVector->toUnit == Point_Int(0, 0, 0))
-		maxVolumeBlocked = shadeVector->volumeBlocked;
+	// The frustrum is convex, so the unit is entirely inside of it if all of its corners are
+	double cornerX[8];
+	double cornerY[8];
+	double cornerZ[8];
+	std::uint8_t cornerHits[8];
+	double h = unitSize * .5;
+	for (int corner = 0; corner < 8; ++corner) {
+
+		cornerX[corner] = unitCenter.x + (corner & 1 ? h : -h);
+		cornerY[corner] = unitCenter.y + (corner & 2 ? h : -h);
+		cornerZ[corner] = unitCenter.z + (corner & 4 ? h : -h);
+	}
+
+	intersectRaysWithSides(blockerUnitSidesFacingOrigin, cornerX, cornerY, cornerZ, 8, cornerHits);
+
+	for (int corner = 0; corner < 8; ++corner) {
+
+		if (!cornerHits[corner])
+			return straddlesFrustum;
+	}
 
-	done.insert(shadeVector);
+	return insideFrustum;
 }
 
-double BlockPointGrid::findVolumeSharedWithNeighbor(const std::vector<std::pair<MVector, MVector>>& blockerUnitSidesFacingOrigin,
-	const std::vector<MVector>& shadedSubdivisions, const double subdivisionSize, const double subdivisionVolume) {
+void BlockPointGrid::computeVolumeSharedWithNeighbors(ShadeVector* shadeVector,
+	const std::unordered_map<Point_Int, ShadeVector*, Point_Int::HashFunction>& shadeVectorsByToUnit,
+	const std::unordered_map<ShadeVector*, std::vector<Subdivision>>& totalOccludedVolumesByShadeVectors, double minSubdivisionSize) const {
 
-	double volume = 0.;
+	for (auto& neighbor : shadeVector->neighborShadeVectors) {
 
-	for (const auto& subdivision : shadedSubdivisions) { // Loop through all subdivisions of the neighbor 
+		// Only canonical ShadeVectors have their occluded subdivisions, so if the neighbor is not canonical, measure the mirror image of the pair instead:
+		// this ShadeVector's unit moved by the same symmetry, against the neighbor's canonical counterpart
+		XZSymmetry toCanonical = XZSymmetry::toCanonical(neighbor.neighbor->toUnit);
+		ShadeVector* canonicalNeighbor = shadeVectorsByToUnit.at(toCanonical.apply(neighbor.neighbor->toUnit));
+		FacingSides unitSidesFacingOrigin = getUnitSidesFacingShadeOrigin(toCanonical.apply(shadeVector->toUnit));
 
-		MVector dir = subdivision.normal(); // Direction to the subdivision
+		neighbor.sharedBlockage = findVolumeSharedWithNeighbor(unitSidesFacingOrigin, totalOccludedVolumesByShadeVectors.at(canonicalNeighbor),
+			minSubdivisionSize);
 
-		// Check for intersection with each side
-		for (const auto& [sideNormal, sideCenter] : blockerUnitSidesFacingOrigin) {
+		neighbor.percentShared = neighbor.sharedBlockage / neighbor.neighbor->volumeBlocked;
+	}
+}
 
-			double dotProduct = (dir * sideNormal);
+void BlockPointGrid::copySharedVolumeFromCanonical(ShadeVector* shadeVector,
+	const std::unordered_map<Point_Int, ShadeVector*, Point_Int::HashFunction>& shadeVectorsByToUnit) const {
 
-			if (dotProduct < -1e-6) {
+	XZSymmetry toCanonical = XZSymmetry::toCanonical(shadeVector->toUnit);
+	const ShadeVector* canonical = shadeVectorsByToUnit.at(toCanonical.apply(shadeVector->toUnit));
 
-				double t = (sideCenter * sideNormal) / dotProduct;
-				MPoint pointOfIntersection = dir * t;
+	// Each child maps to the child of the canonical ShadeVector in the same mirrored direction
+	for (auto& neighbor : shadeVector->neighborShadeVectors) {
 
-				// The line intersects with the plane the side lies on, but we still need to check if that point of intersection
-				// actually lies within the area of the unit's side.  
-				if (pointOfIntersectionIsOnSide(pointOfIntersection, sideNormal, sideCenter, dir)) {
+		Point_Int mirroredNeighbor = toCanonical.apply(neighbor.neighbor->toUnit);
+		for (const auto& canonicalNeighbor : canonical->neighborShadeVectors) {
 
-					volume += subdivisionVolume;
-					break;
-				}
+			if (canonicalNeighbor.neighbor->toUnit == mirroredNeighbor) {
+
+				neighbor.sharedBlockage = canonicalNeighbor.sharedBlockage;
+				neighbor.percentShared = canonicalNeighbor.percentShared;
+				break;
 			}
 		}
 	}
+}
 
-	return volume;
+double BlockPointGrid::findVolumeSharedWithNeighbor(const FacingSides& blockerUnitSidesFacingOrigin,
+	const std::vector<Subdivision>& shadedSubdivisions, const double minSubdivisionSize) const {
+
+	return computeShadedVolume(blockerUnitSidesFacingOrigin, shadedSubdivisions.data(), shadedSubdivisions.size(), minSubdivisionSize, nullptr);
 }
 
-std::vector<std::pair<MVector, MVector>> BlockPointGrid::getUnitSidesFacingShadeOrigin(const ShadeVector& sv) const {
+FacingSides BlockPointGrid::getUnitSidesFacingShadeOrigin(const Point_Int& toUnit) const {
 
-	std::vector<std::pair<MVector, MVector>> unitSidesFacingOrigin;
-	if (sv.toUnit != shadeRoot->toUnit) {
+	// Points of intersection on the very edge of sides are considered on the side, which results in overlapping volumes
+	FacingSides unitSidesFacingOrigin;
+	unitSidesFacingOrigin.halfWidth = unitSize * .5 + 1e-6;
 
-		if (sv.toUnit.x != 0) {
-			double opposite = sv.toUnit.x > 0 ? -1. : 1.;
-			MVector normal = { opposite, 0., 0. };
-			MVector location = (sv.toUnit.toMVector() * unitSize) + (normal * (unitSize * .5));
-			unitSidesFacingOrigin.push_back({ normal, location });
-		}
+	if (toUnit != Point_Int(0, 0, 0)) {
+
+		const int index[3] = { toUnit.x, toUnit.y, toUnit.z };
+		for (int axis = 0; axis < 3; ++axis) {
 
-		if (sv.toUnit.y != 0) {
-			double opposite = sv.toUnit.y > 0 ? -1. : 1.;
-			MVector normal = { 0., opposite, 0. };
-			MVector location = (sv.toUnit.toMVector() * unitSize) + (normal * (unitSize * .5));
-			unitSidesFacingOrigin.push_back({ normal, location });
+			if (index[axis] != 0) {
+
+				double opposite = index[axis] > 0 ? -1. : 1.;
+				double location[3] = { toUnit.x * unitSize, toUnit.y * unitSize, toUnit.z * unitSize };
+				location[axis] += opposite * (unitSize * .5);
+				unitSidesFacingOrigin.add(axis, opposite, location[0], location[1], location[2]);
+			}
 		}
 
-		if (sv.toUnit.z != 0) {
-			double opposite = sv.toUnit.z > 0 ? -1. : 1.;
-			MVector normal = { 0., 0., opposite };
-			MVector location = (sv.toUnit.toMVector() * unitSize) + (normal * (unitSize * .5));
-			unitSidesFacingOrigin.push_back({ normal, location });
+		/*
+			Every ray that hits a side passes through the unit's cube, grown by the edge tolerance, so the frustrum lies within the cone from the
+			origin through that cube.  The cone is bounded by the planes through the origin and those edges of the cube that every corner of
+			the cube is on one side of.
+		*/
+		double h = unitSidesFacingOrigin.halfWidth;
+		MVector corners[8];
+		for (int corner = 0; corner < 8; ++corner)
+			corners[corner] = toUnit.toMVector() * unitSize + MVector(corner & 1 ? h : -h, corner & 2 ? h : -h, corner & 4 ? h : -h);
+
+		for (int corner = 0; corner < 8; ++corner) {
+			for (int bit = 1; bit < 8; bit <<= 1) {
+
+				if (corner & bit)
+					continue;
+
+				MVector normal = corners[corner] ^ corners[corner | bit];
+				double tolerance = normal.length() * corners[corner].length() * 1e-9;
+
+				bool allPositive = true;
+				bool allNegative = true;
+				for (const MVector& other : corners) {
+
+					allPositive = allPositive && normal * other >= -tolerance;
+					allNegative = allNegative && normal * other <= tolerance;
+				}
+
+				if (allNegative)
+					normal = -normal;
+
+				if (allPositive || allNegative)
+					unitSidesFacingOrigin.addBoundingPlane(normal.x, normal.y, normal.z);
+			}
 		}
 	}
 	else {
@@ -738,111 +1712,110 @@ std::vector<std::pair<MVector, MVector>> BlockPointGrid::getUnitSidesFacingShade
 		// for intersection.  Assuming the shade range angle is never greater than 180 degrees, this will always be all sides except for the top.
 		// Also, note that every subdivision tested is gauranteed to intersect with these, so we could definitely leverage that to improve 
 		// performance.  But doing it this way keeps it consistent with the way other ShadeVectors are calculated and may make the code less error prone.
-		unitSidesFacingOrigin.push_back({ {0., 1., 0.}, {0.,-unitSize * .5, 0.} });
-		unitSidesFacingOrigin.push_back({ {-1., 0., 0.}, { unitSize * .5, 0., 0.} });
-		unitSidesFacingOrigin.push_back({ {0., 0., -1.}, {0.,0., unitSize * .5 } });
-		unitSidesFacingOrigin.push_back({ {1., 0., 0.}, {-unitSize * .5,0., 0.} });
-		unitSidesFacingOrigin.push_back({ {0., 0., 1.}, {0.,0., -unitSize * .5} });
-
+		unitSidesFacingOrigin.add(1, 1., 0., -unitSize * .5, 0.);
+		unitSidesFacingOrigin.add(0, -1., unitSize * .5, 0., 0.);
+		unitSidesFacingOrigin.add(2, -1., 0., 0., unitSize * .5);
+		unitSidesFacingOrigin.add(0, 1., -unitSize * .5, 0., 0.);
+		unitSidesFacingOrigin.add(2, 1., 0., 0., -unitSize * .5);
 	}
 
 	return unitSidesFacingOrigin;
 }
 
-double BlockPointGrid::computeShadedVolume(const std::vector<std::pair<MVector, MVector>>& blockerUnitSidesFacingOrigin,
-	const std::vector<MVector>& neighborSubdivisions, std::vector<MVector>& subdivisionsInVolume,
-	const double subdivisionSize, const double subdivisionVolume) {
+double BlockPointGrid::computeShadedVolume(const FacingSides& blockerUnitSidesFacingOrigin,
+	const std::vector<Subdivision>& neighborSubdivisions, std::vector<Subdivision>& subdivisionsInVolume, const double minSubdivisionSize) const {
+
+	return computeShadedVolume(blockerUnitSidesFacingOrigin, neighborSubdivisions.data(), neighborSubdivisions.size(), minSubdivisionSize, &subdivisionsInVolume);
+}
+
+double BlockPointGrid::computeShadedVolume(const FacingSides& blockerUnitSidesFacingOrigin, const Subdivision* subdivisions, std::size_t count,
+	const double minSubdivisionSize, std::vector<Subdivision>* subdivisionsInVolume) const {
+
+	// The rays to the subdivisions' centers are tested in batches, with the coordinates split into separate arrays for intersectRaysWithSides
+	const std::size_t BATCH_SIZE = 64;
+	double x[BATCH_SIZE];
+	double y[BATCH_SIZE];
+	double z[BATCH_SIZE];
+	std::uint8_t centerHits[BATCH_SIZE];
 
 	double volume = 0.;
 
-	for (const auto& subdivision : neighborSubdivisions) { // Loop through all subdivisions of the neighbor 
+	for (std::size_t batchStart = 0; batchStart < count; batchStart += BATCH_SIZE) {
 
-		MVector dir = subdivision.normal(); // Direction to the subdivision
+		std::size_t batchCount = std::min(BATCH_SIZE, count - batchStart);
+		for (std::size_t i = 0; i < batchCount; ++i) {
 
-		// Check for intersection with each side
-		for (const auto& [sideNormal, sideCenter] : blockerUnitSidesFacingOrigin) {
+			const MVector& center = subdivisions[batchStart + i].center;
+			x[i] = center.x;
+			y[i] = center.y;
+			z[i] = center.z;
+		}
 
-			double dotProduct = (dir * sideNormal);
+		intersectRaysWithSides(blockerUnitSidesFacingOrigin, x, y, z, batchCount, centerHits);
 
-			/*
-				If the dot product of the side normal and direction to the subd is 0 or very close to it, then the two vectors are about perpendicular,
-				meaning our line is about parallel to the plane and cannot intersect.  This shouldn't be possible since we established that these
-				planes face the origin from which the line to the unit is drawn, but just to be safe...  Also, note we are checking that the dot product
-				is negative, indicating the direction to the subd faces the normal, i.e. the angle between them is greater than 90 degrees.
-			*/
-			if (dotProduct < -1e-6) {
+		for (std::size_t i = 0; i < batchCount; ++i) {
 
-				double t = (sideCenter * sideNormal) / dotProduct;
-				MPoint pointOfIntersection = dir * t;
+			const Subdivision& subdivision = subdivisions[batchStart + i];
+			bool centerIsShaded = centerHits[i] != 0;
 
+			// Subdivisions of the smallest size are treated as shaded or not based only on their center
+			if (subdivision.size <= minSubdivisionSize * 1.000001) {
 
-				// The line intersects with the plane the side lies on, but we still need to check if that point of intersection
-				// actually lies within the area of the unit's side.  
-				if (pointOfIntersectionIsOnSide(pointOfIntersection, sideNormal, sideCenter, dir)) {
+				if (centerIsShaded) {
 
-					volume += subdivisionVolume;
-					subdivisionsInVolume.push_back(subdivision);
-					break;
+					volume += subdivision.volume();
+					if (subdivisionsInVolume)
+						subdivisionsInVolume->push_back(subdivision);
 				}
+
+				continue;
 			}
-		}
-	}
 
-	return volume;
-}
+			/*
+				The frustrum beyond the blocker's unit is convex, so if every corner of the subdivision is in it, the whole subdivision is.  It is only
+				treated as unshaded if it lies entirely outside one of the frustrum's bounding planes, since the frustrum can pass between its corners.
+				Otherwise, the subdivision straddles the edge of the frustrum and is divided further.
+			*/
+			double h = subdivision.size * .5;
+			if (blockerUnitSidesFacingOrigin.cubeIsOutside(subdivision.center.x, subdivision.center.y, subdivision.center.z, h))
+				continue;
+
+			double cornerX[8];
+			double cornerY[8];
+			double cornerZ[8];
+			std::uint8_t cornerHits[8];
+			for (int corner = 0; corner < 8; ++corner) {
+
+				cornerX[corner] = subdivision.center.x + (corner & 1 ? h : -h);
+				cornerY[corner] = subdivision.center.y + (corner & 2 ? h : -h);
+				cornerZ[corner] = subdivision.center.z + (corner & 4 ? h : -h);
+			}
 
-bool BlockPointGrid::pointOfIntersectionIsOnSide(const MPoint& pointOfIntersection, const MVector& sideNormal, const MVector& sideCenter, const MVector& ray) const {
+			intersectRaysWithSides(blockerUnitSidesFacingOrigin, cornerX, cornerY, cornerZ, 8, cornerHits);
 
-	/*
-		A point of intersection with the plane the side lies on has been found, but we still need to check if that point
-		actually lies within the area of the unit's side.  For this, we can get the vector from the side's center
-		to that POI and check whether its dimensions perpendicular to the side's normal are greater than half the unit size.
-		If any of them are, then the poi is not on the side. Note that points on the very edge of sides are considered on the
-		side, which results in overlapping volumes.
-	*/
+			int shadedCorners = 0;
+			for (int corner = 0; corner < 8; ++corner)
+				shadedCorners += cornerHits[corner];
 
-	MVector centerToPOI = pointOfIntersection - sideCenter;
-	double toEdgeApprox = unitSize * .5 + 1e-6;
+			if (shadedCorners == 8 && centerIsShaded) {
 
-	// This commented section will eliminate overlaps (I think...still needs more testing).  Not sure if it's necessary.
-	/*if (almostEqual(sideNormal.y, 0.)) {
+				volume += subdivision.volume();
+				if (subdivisionsInVolume)
+					subdivisionsInVolume->push_back(subdivision);
 
-		if (std::abs(centerToPOI.y) > toEdgeApprox) {
-			return false;
-		}
-		else if (almostEqual(centerToPOI.y, unitSize * .5)) {
-			return false;
-		}
-	}
-	else {
+				continue;
+			}
 
-		if (ray.x > 0 && centerToPOI.x > 0 && almostEqual(centerToPOI.x, unitSize * .5)) {
-			return false;
-		}
+			Subdivision eighths[8];
+			double q = subdivision.size * .25;
+			for (int child = 0; child < 8; ++child)
+				eighths[child] = { subdivision.center + MVector(child & 1 ? q : -q, child & 2 ? q : -q, child & 4 ? q : -q), subdivision.size * .5 };
 
-		if (ray.x < 0 && centerToPOI.x < 0 && almostEqual(centerToPOI.x, -unitSize * .5)) {
-			return false;
+			volume += computeShadedVolume(blockerUnitSidesFacingOrigin, eighths, 8, minSubdivisionSize, subdivisionsInVolume);
 		}
 	}
 
-	if (ray.z > 0 && centerToPOI.z > 0 && almostEqual(centerToPOI.z, unitSize * .5)) {
-		return false;
-	}
-
-	if (ray.z < 0 && centerToPOI.z < 0 && almostEqual(centerToPOI.z, -unitSize * .5)) {
-		return false;
-	}*/
-
-	if ((almostEqual(sideNormal.x, 0.) && std::abs(centerToPOI.x) > toEdgeApprox)
-		|| (almostEqual(sideNormal.y, 0.) && std::abs(centerToPOI.y) > toEdgeApprox)
-		|| (almostEqual(sideNormal.z, 0.) && std::abs(centerToPOI.z) > toEdgeApprox))
-	{
-		// The POI is not on the side
-		return false;
-	}
-	else {
-		return true;
-	}
+	return volume;
 }
 
 void BlockPointGrid::finalizeSharedVolumeBlocked() const {
@@ -924,38 +1897,97 @@ void BlockPointGrid::finalizeSharedVolumeBlocked() const {
 	}
 }
 
-std::vector<MVector> BlockPointGrid::getSubDivisionsInShadeRange(const MVector& vectorToUnit, int timesToSubDivide) {
+std::vector<Subdivision> BlockPointGrid::getSubDivisionsInShadeRange(const MVector& vectorToUnit, double minSubdivisionSize) const {
 
-	double intersectionVolume = 0.;
-	std::vector<MVector> subdivisions;
-	std::vector<MVector> cubesToDivide = { vectorToUnit };
-	double subDivisionSize = unitSize;
+	std::vector<Subdivision> subdivisionsInRange;
+	findSubdivisionsInShadeRange({ vectorToUnit, unitSize }, minSubdivisionSize, subdivisionsInRange);
+
+	return subdivisionsInRange;
+}
 
-	// This loop will yield a list of centers of cubic subdivisions of the unit.  The number of subdivisions is 8^timesToSubDivide
-	for (int i = 0; i < timesToSubDivide; ++i) {
+void BlockPointGrid::findSubdivisionsInShadeRange(const Subdivision& subdivision, double minSubdivisionSize, std::vector<Subdivision>& subdivisionsInRange) const {
 
-		subdivisions.clear();
+	MVector down = { 0.,-1.,0. };
 
-		for (const auto& c : cubesToDivide) {
+	// Subdivisions of the smallest size are in range or not based only on their center
+	if (subdivision.size <= minSubdivisionSize * 1.000001) {
 
-			divideCubeToEighths(c, subDivisionSize, subdivisions);
-		}
+		if (subdivision.center.length() < shadeRange && subdivision.center.angle(down) <= halfConeAngle)
+			subdivisionsInRange.push_back(subdivision);
 
-		subDivisionSize *= .5;
-		cubesToDivide = subdivisions;
+		return;
 	}
 
-	std::vector<MVector> subdivisionsInRange;
-	MVector down = { 0.,-1.,0. };
-	for (const auto& s : subdivisions) {
+	// Skip the subdivision if the sphere around it lies entirely beyond the shade range's radius or entirely outside of its cone
+	double distance = subdivision.center.length();
+	double boundingRadius = subdivision.size * std::sqrt(3.) * .5;
+	if (distance - boundingRadius >= shadeRange)
+		return;
 
-		if (s.length() < shadeRange && s.angle(down) <= halfConeAngle) {
+	if (distance > boundingRadius && subdivision.center.angle(down) - std::asin(boundingRadius / distance) > halfConeAngle)
+		return;
 
-			subdivisionsInRange.push_back(s);
-		}
+	// The shade range is convex as long as the cone is no wider than a half space, in which case the subdivision is entirely in range if all of its corners are
+	bool allCornersInRange = halfConeAngle <= MH::PI * .5;
+	double h = subdivision.size * .5;
+	for (int corner = 0; corner < 8 && allCornersInRange; ++corner) {
+
+		MVector cornerLocation = subdivision.center + MVector(corner & 1 ? h : -h, corner & 2 ? h : -h, corner & 4 ? h : -h);
+		double cornerDistance = cornerLocation.length();
+		allCornersInRange = cornerDistance < shadeRange && (cornerDistance < 1e-9 || cornerLocation.angle(down) <= halfConeAngle);
 	}
 
-	return subdivisionsInRange;
+	if (allCornersInRange) {
+
+		subdivisionsInRange.push_back(subdivision);
+		return;
+	}
+
+	// The subdivision straddles the edge of the shade range, so check each of its eighths
+	double q = subdivision.size * .25;
+	for (int child = 0; child < 8; ++child) {
+
+		Subdivision eighth = { subdivision.center + MVector(child & 1 ? q : -q, child & 2 ? q : -q, child & 4 ? q : -q), subdivision.size * .5 };
+		findSubdivisionsInShadeRange(eighth, minSubdivisionSize, subdivisionsInRange);
+	}
+}
+
+const std::vector<Subdivision>& BlockPointGrid::getCanonicalSubdivisionsInShadeRange(const Point_Int& toUnit, double minSubdivisionSize,
+	std::unordered_map<Point_Int, std::vector<Subdivision>, Point_Int::HashFunction>& canonicalSubdivisions) const {
+
+	Point_Int canonicalToUnit = XZSymmetry::toCanonical(toUnit).apply(toUnit);
+
+	auto found = canonicalSubdivisions.find(canonicalToUnit);
+	if (found == canonicalSubdivisions.end())
+		found = canonicalSubdivisions.emplace(canonicalToUnit, getSubDivisionsInShadeRange(canonicalToUnit.toMVector() * unitSize, minSubdivisionSize)).first;
+
+	return found->second;
+}
+
+const std::vector<Subdivision>& BlockPointGrid::getSymmetricSubdivisionsInShadeRange(const Point_Int& toUnit,
+	const std::unordered_map<Point_Int, std::vector<Subdivision>, Point_Int::HashFunction>& canonicalSubdivisions, std::vector<Subdivision>& mirroredSubdivisions) const {
+
+	XZSymmetry toCanonical = XZSymmetry::toCanonical(toUnit);
+	Point_Int canonicalToUnit = toCanonical.apply(toUnit);
+	const std::vector<Subdivision>& subdivisions = canonicalSubdivisions.at(canonicalToUnit);
+
+	if (canonicalToUnit == toUnit)
+		return subdivisions;
+
+	mirroredSubdivisions.clear();
+	for (const auto& subdivision : subdivisions)
+		mirroredSubdivisions.push_back({ toCanonical.applyInverse(subdivision.center), subdivision.size });
+
+	return mirroredSubdivisions;
+}
+
+double BlockPointGrid::getTotalVolume(const std::vector<Subdivision>& subdivisions) {
+
+	double volume = 0.;
+	for (const auto& subdivision : subdivisions)
+		volume += subdivision.volume();
+
+	return volume;
 }
 
 void BlockPointGrid::divideCubeToEighths(const MVector& cubeCenter, double size, std::vector<MVector>& subdivisions) {
@@ -972,16 +2004,25 @@ void BlockPointGrid::divideCubeToEighths(const MVector& cubeCenter, double size,
 	subdivisions.push_back(MPoint(cubeCenter.x + q, cubeCenter.y + q, cubeCenter.z - q));
 }
 
-void BlockPointGrid::attachBPCallbacks(std::vector<std::shared_ptr<BlockPoint>> bps) {
+void BlockPointGrid::attachBPCallbacks(const std::vector<BlockPointHandle>& bps) {
 	MGlobal::displayInfo(MString() + "Attaching");
 	MStatus status;
 
-	for (auto& bp : bps) {
+	for (const auto& handle : bps) {
+
+		BlockPoint* bp = blockPoints.get(handle);
+		if (!bp)
+			continue;
+
+		bpCallbackContexts.push_back(std::make_unique<BlockPointCallbackContext>());
+		BlockPointCallbackContext* context = bpCallbackContexts.back().get();
+		context->grid = this;
+		context->handle = handle;
 
 		MObject bpTransformNode = bp->getTransformNode();
 		MFnTransform bpTransformFn(bpTransformNode);
-		bpCallbackIds.append(MNodeMessage::addAttributeChangedCallback(bpTransformNode, BlockPointGrid::updateGridFromBPChange, static_cast<void*>(bp.get()), &status));
-		bpCallbackIds.append(MNodeMessage::addNodePreRemovalCallback(bpTransformNode, BlockPointGrid::updateGridAfterBPRemoval, static_cast<void*>(bp.get()), &status));
+		bpCallbackIds.append(MNodeMessage::addAttributeChangedCallback(bpTransformNode, BlockPointGrid::updateGridFromBPChange, static_cast<void*>(context), &status));
+		bpCallbackIds.append(MNodeMessage::addNodePreRemovalCallback(bpTransformNode, BlockPointGrid::updateGridAfterBPRemoval, static_cast<void*>(context), &status));
 	}
 }
 
@@ -994,15 +2035,19 @@ void BlockPointGrid::updateGridFromBPChange(MNodeMessage::AttributeMessage msg,
 
 		MStatus status;
 
-		BlockPoint* bp = static_cast<BlockPoint*>(clientData);
-		MVector bpTranslation = getObjectTranslation(plug.node(&status), status);
-		MPoint currentLoc(bpTranslation);
-		Point_Int meshUnit = bp->getGrid()->pointToIndex(currentLoc);
-		if (bp->getCurrentUnit() != meshUnit) {
+		BlockPointCallbackContext* context = static_cast<BlockPointCallbackContext*>(clientData);
+		BlockPoint* bp = context->grid->getBlockPoint(context->handle);
+		if (bp) {
 
-			bp->getGrid()->moveBlockPoint(*bp, currentLoc);
-			bp->getGrid()->applyShade();
-			bp->setCurrentUnit(meshUnit);
+			MVector bpTranslation = getObjectTranslation(plug.node(&status), status);
+			MPoint currentLoc(bpTranslation);
+			Point_Int meshUnit = context->grid->pointToIndex(currentLoc);
+			if (bp->getCurrentUnit() != meshUnit) {
+
+				context->grid->moveBlockPoint(*bp, currentLoc);
+				context->grid->applyShade();
+				bp->setCurrentUnit(meshUnit);
+			}
 		}
 	}
 
@@ -1011,19 +2056,17 @@ void BlockPointGrid::updateGridFromBPChange(MNodeMessage::AttributeMessage msg,
 
 void BlockPointGrid::updateGridAfterBPRemoval(MObject& node, void* clientData) {
 
-	BlockPoint* bp = static_cast<BlockPoint*>(clientData);
-	std::shared_ptr<BlockPoint> temp = bp->getSharedFromThis();
+	BlockPointCallbackContext* context = static_cast<BlockPointCallbackContext*>(clientData);
 
 	// Check whether the bp has already been removed.  This would happen if we triggered this callback via deleteAllBlockPoints
-	if (!bp->getGrid()->hasBlockPoint(temp))
+	if (!context->grid->hasBlockPoint(context->handle))
 		return;
 
-	bp->getGrid()->deleteBlockPoint(temp);
-	bp->getGrid()->applyShade();
+	context->grid->deleteBlockPoint(context->handle);
+	context->grid->applyShade();
 }
 
-void BlockPointGrid::displayShadeVectorUnitsByLevel(double subdivisionSize,
-	std::unordered_map<ShadeVector*, std::vector<MVector>>& totalOccludedVolumesByShadeVectors) {
+void BlockPointGrid::displayShadeVectorUnitsByLevel(std::unordered_map<ShadeVector*, std::vector<Subdivision>>& totalOccludedVolumesByShadeVectors) {
 
 	MStatus status;
 	MFnDagNode svByLevelDagNodeFn;
@@ -1072,7 +2115,7 @@ void BlockPointGrid::displayShadeVectorUnitsByLevel(double subdivisionSize,
 
 				for (const auto& subdivision : totalOccludedVolumesByShadeVectors[sv]) {
 
-					makeSubdMesh(subdivision, subdivisionSize, ++subdCounter, totalSubdsDagNodeFn);
+					makeSubdMesh(subdivision.center, subdivision.size, ++subdCounter, totalSubdsDagNodeFn);
 				}
 			}
 
@@ -1128,10 +2171,10 @@ void BlockPointGrid::displayAllBlockPoints(bool d) {
 
 		for (auto& bp : blockPoints) {
 
-			MObject transformNode = bp->getTransformNode();
+			MObject transformNode = bp.getTransformNode();
 			if (transformNode.isNull()) {
 
-				bp->createBPMesh(bpMeshGroupDagNodeFn, defaultShadingGroup);
+				bp.createBPMesh(bpMeshGroupDagNodeFn, defaultShadingGroup);
 			}
 
 			MFnDagNode bpDagNode(transformNode, &status);
@@ -1144,7 +2187,7 @@ void BlockPointGrid::displayAllBlockPoints(bool d) {
 
 		for (auto& bp : blockPoints) {
 
-			MObject transformNode = bp->getTransformNode();
+			MObject transformNode = bp.getTransformNode();
 			if (!transformNode.isNull()) {
 
 				MFnDagNode bpDagNode(transformNode, &status);
@@ -1156,13 +2199,17 @@ void BlockPointGrid::displayAllBlockPoints(bool d) {
 	}
 }
 
-void BlockPointGrid::displayBlockPoints(std::vector<std::shared_ptr<BlockPoint>> bpsToDisplay) {
+void BlockPointGrid::displayBlockPoints(const std::vector<BlockPointHandle>& bpsToDisplay) {
 
 	MStatus status;
 	MFnDagNode bpMeshGroupDagNodeFn;
 	bpMeshGroupDagNodeFn.setObject(bpMeshGroup);
 
-	for (auto& bp : bpsToDisplay) {
+	for (const auto& handle : bpsToDisplay) {
+
+		BlockPoint* bp = blockPoints.get(handle);
+		if (!bp)
+			continue;
 
 		MObject transformNode = bp->getTransformNode();
 		if (transformNode.isNull()) {
@@ -1179,12 +2226,17 @@ void BlockPointGrid::displayBlockPoints(std::vector<std::shared_ptr<BlockPoint>>
 
 void BlockPointGrid::toggleDisplayShadedUnits(bool display) {
 
+	// Every unit is visited, so none can be left stale
+	flushLightConditions();
+
 	displayShadedUnits = display;
 	traverseRange(Point_Int(0, 0, 0), Point_Int(xElements, yElements, zElements), [this](GridUnit& unit) { displayShadedUnitIf(unit); });
 }
 
 void BlockPointGrid::toggleDisplayShadedUnitArrows(bool display) {
 
+	flushLightConditions();
+
 	displayShadedUnitArrows = display;
 	traverseRange(Point_Int(0, 0, 0), Point_Int(xElements, yElements, zElements), [this](GridUnit& unit) { displayAffectedUnitArrowIf(unit); });
 }
@@ -34,10 +34,23 @@ the growth rate and direction of any trees below them.
 #include <maya/MSelectionList.h>
 
 #include "GridUnit.h"
+#include "GridUnitStore.h"
+#include "Morton.h"
 #include "ShadeVector.h"
+#include "ShadeVectorGraph.h"
 #include "BlockPoint.h"
+#include "CapsuleOccluder.h"
+#include "MeshVoxelizer.h"
+#include "PointCloudLoader.h"
+#include "CoverageStencil.h"
 #include "MathHelper.h"
 #include "SimpleShapes.h"
+#include "ShadeVectorGraphCache.h"
+#include "ParallelFor.h"
+#include "XZSymmetry.h"
+#include "RayFaceKernel.h"
+#include "LightFieldKernel.h"
+#include "SlotMap.h"
 
 class BlockPointGrid {
 
@@ -60,6 +73,16 @@ class BlockPointGrid {
 
 	MCallbackIdArray bpCallbackIds;
 
+	// What block point callbacks are passed as client data.  The grid owns these so that they outlive the callbacks, which are removed when
+	// the grid is destroyed, and so that a callback for a block point that has since been deleted finds a stale handle rather than a dangling pointer.
+	struct BlockPointCallbackContext {
+
+		BlockPointGrid* grid = nullptr;
+		BlockPointHandle handle;
+	};
+
+	std::vector<std::unique_ptr<BlockPointCallbackContext>> bpCallbackContexts;
+
 	std::vector<Point_Int> unitsOnDisplayByCameraMove;
 
 	std::vector<Point_Int> unitsOnDisplayNearPoints;
@@ -68,10 +91,13 @@ class BlockPointGrid {
 
 	enum adjustment { add = 1, subtract = -1 };
 
+	// How a unit lies relative to the frustrum beyond a blocking unit
+	enum frustumOverlap { outsideFrustum, insideFrustum, straddlesFrustum };
+
 	// We want the grid to be represented as centered on the Maya grid.  This means that x and z elements must always be an odd
 	// number.  E.g. xSize / xUnitSize is always an odd number.  Also, this means that the center element itself is centered on
 	// the Maya grid.  E.g. the x and z coordinates at the center of the center element are 0. and 0.
-	std::vector< std::vector< std::vector<GridUnit> > > grid;
+	GridUnitStore units;
 
 	bool displayShadedUnits = false;
 	bool displayShadedUnitArrows = false;
@@ -101,24 +127,121 @@ class BlockPointGrid {
 
 	double intensity = 0.;
 
+	// The number of threads used to build the ShadeVector graph and to propagate batches of shade.  0 uses one thread per hardware thread.
+	unsigned int threadCount = 0;
+
+	// The volumes used to build the ShadeVector graph are approximated by dividing units into cubic subdivisions.  Only subdivisions that straddle
+	// the edge of the shade range or of a blocker's frustum are divided further, down to a size of unitSize / 2^subdivisionDepth.
+	int subdivisionDepth = 3;
+
+	// When true, units are allocated in bricks as block points or shade first reach them, rather than all at once.  Units that haven't been
+	// allocated are fully lit.
+	bool sparse = false;
+
 	// GridUnits whose light conditions have changed.  This is checked, handled, and cleared after all blockpoint / segment adjustments have been made for 
 	// all trees for a given time loop or after post deformers
-	std::unordered_set<GridUnit*> dirtyUnits;
+	std::unordered_set<std::uint32_t> dirtyUnits;
+
+	// When true, updateAllUnitsLightConditions only marks dirty units' light conditions stale, and they are evaluated when first read or
+	// flushed.  Units that have meshes, or that would be given one, are still evaluated right away.
+	bool lazyLightConditions = false;
+
+	// Units whose light conditions are stale.  Always empty unless lazyLightConditions is true.
+	std::unordered_set<std::uint32_t> staleUnits;
 
 	// Units whose densityIncludingExcess has been modified this iteration
-	std::unordered_set<GridUnit*> dirtyDensityUnits;
+	std::unordered_set<std::uint32_t> dirtyDensityUnits;
+
+	// Coverage stencils of every block point radius and sub-unit position seen so far
+	CoverageStencilCache coverageStencils;
 
-	// Note that the contactPathIndex and shadeVector for the root ShadeVector should never be used
+	// The root of the ShadeVector graph while it is being built.  Its children are released once the graph is frozen into shadeVectorGraph.
+	// Note that the shadeVector for the root ShadeVector should never be used
 	std::shared_ptr<ShadeVector> shadeRoot = std::make_shared<ShadeVector>(Point_Int(0, 0, 0));
 
-	std::vector<std::shared_ptr<ShadeVector>> toUnitsInShade;
+	// The finished ShadeVector graph, used for propagation
+	ShadeVectorGraph shadeVectorGraph;
+
+	// Reused by propagateFrom and propagateBatch so that they don't allocate on every call
+	PropagationScratch propagationScratch;
+	BatchPropagationScratch batchPropagationScratch;
+
+	// Batched propagation splits each level into columns of PROPAGATION_TILE_SIZE by PROPAGATION_TILE_SIZE units, which are handled in parallel
+	// when the level has at least MIN_PARALLEL_RELAYS relays
+	static const int PROPAGATION_TILE_SIZE = 8;
+	static const std::size_t MIN_PARALLEL_RELAYS = 2048;
+
+	// A merged relay whose percentage is no more than this fraction of the percentages merged into it is shade added and removed in the same
+	// batch, and is dropped
+	static constexpr double CANCELLED_RELAY_TOLERANCE = 1e-9;
+
+	// Light queries are split between threads, a block of LightCorners::BLOCK_SIZE points at a time, in batches of at least this many points
+	static const std::size_t MIN_PARALLEL_LIGHT_QUERIES = 4096;
+
+	// Stale units are evaluated in blocks of LightConditionBlock::BLOCK_SIZE, which are split between threads when there are at least this many units
+	static const std::size_t MIN_PARALLEL_LIGHT_EVALUATIONS = 4096;
+
+	// Blocked units are counted in cubic cells of OCCUPANCY_CELL_SIZE units on a side, so that applyShade can quickly tell whether anything
+	// is blocked within a blocker's free field stencil.  Cells are ordered x, then y, then z, like the grid.
+	static const int OCCUPANCY_CELL_SIZE = 4;
+	std::vector<int> blockedUnitsByCell;
+	int xCells = 0;
+	int yCells = 0;
+	int zCells = 0;
 
 	// The magnitude of the sum of all vectors in CONTACT_VECTORS that are within the shaded sector, times unit size
 	double maxVolumeBlocked = 0.1;
 
 	double attenuationRate = .1;
 
-	std::vector<std::shared_ptr<BlockPoint>> blockPoints;
+	SlotMap<BlockPoint> blockPoints;
+
+	// The handle of each block point by its id, which is the number in its name and how commands refer to it
+	std::unordered_map<int, BlockPointHandle> blockPointIds;
+	int nextBlockPointId = 0;
+
+	SlotMap<CapsuleOccluder> capsules;
+
+	// Where a moved capsule's new coverage is built before it is swapped with the old
+	std::vector<CoverageRun> capsuleCoverageScratch;
+
+	// A mesh that has been voxelized into the grid, and the density it added to each unit it covers
+	struct OccluderMesh {
+
+		VoxelizedMesh voxels;
+		int density = 1;
+		int id = 0;
+	};
+
+	SlotMap<OccluderMesh> meshes;
+
+	// The handle of each mesh by its id, which is how commands refer to it
+	std::unordered_map<int, MeshHandle> meshIds;
+
+	// Bulk block point changes gather the units each block point covers in parallel, in chunks of this many block points
+	static const std::size_t BLOCK_POINT_CHUNK_SIZE = 256;
+
+	// A change to the density of the unit at a grid index, keyed by the index's Morton code
+	struct DensityDelta {
+
+		std::uint64_t key;
+		int delta;
+	};
+
+	// A point cloud that has been loaded into the grid, and the density it added to each unit it covers
+	struct OccluderPointCloud {
+
+		std::vector<DensityDelta> deltas;
+		int id = 0;
+	};
+
+	SlotMap<OccluderPointCloud> pointClouds;
+
+	// The handle of each point cloud by its id, which is how commands refer to it
+	std::unordered_map<int, PointCloudHandle> pointCloudIds;
+
+	// Meshes and point clouds take their ids from the same count, so an id never refers to one of each
+	int nextOccluderId = 0;
 
 	// This vector represents the direction of light in the absence of block points.  Useful when a meristem
 	// is ignoring block points
@@ -138,22 +261,90 @@ class BlockPointGrid {
 	void createShadeVectorGraph();
 
 	// Propagate from the given shade index, either adding or removing shade.  If add is false, then remove.
-	MStatus propagateFrom(ShadeVector* startShadeVector, Point_Int blockerIndex, double startingPercentage, bool add);
+	MStatus propagateFrom(ShadeVectorGraph::Index startShadeVector, Point_Int blockerIndex, double startingPercentage, bool add);
+
+	// Adds or removes the shade cast by a blocker at blockerIndex.  When no other unit is blocked within the graph's free field stencil this is
+	// a single pass over the stencil, otherwise it falls back to propagateFrom.
+	MStatus propagateFromRoot(const Point_Int& blockerIndex, bool add);
+
+	/*
+		Propagates the shade changes of all of the units whose density changed in one pass.  For each unit (with add true if it became dense), the
+		shade travelling through it is seeded with the opposite sign and its own shade with the same sign, all before any unit's blocked state
+		changes.  The new blocked states are then set, and every seed advances together level by level, merging relays that reach the same unit
+		through the same ShadeVector.  The result matches calling propagateFrom for each unit in turn, but overlapping shade is walked only once.
+
+		Each level is split into tiles whose relays are merged and expanded on up to threadCount threads.  The tiles' results are then applied
+		to the units one tile after another, in the same order every time, so the outcome doesn't depend on the number of threads.
+	*/
+	MStatus propagateBatch(const std::vector<std::pair<std::uint32_t, bool>>& changedUnits);
+
+	// Adds the children of sv, placed at origin, to relays with percentage scaled by each child's percentShared.  Children off of the grid are skipped.
+	void seedBatch(ShadeVectorGraph::Index sv, const Point_Int& origin, double percentage, std::vector<BatchRelay>& relays) const;
+
+	// Merges the tile's relays into tile.merged and adds the children of those that pass through unblocked units to tile.children
+	void mergeAndExpandTile(BatchTile& tile) const;
 
-	// Find all ShadeVectors in shade range and add them and their subdivisions to svSubds.  This also sets each ShadeVector's face-adjacent neighbors
-	void findAllShadeVectorSubdivisions(std::unordered_map< ShadeVector*, std::vector<MVector>>& subdivisionsByUnit,
-		std::unordered_map<ShadeVector*, std::vector<MVector>>& totalOccludedVolumesByShadeVectors, double subdivisionVolume, double timesToSubDivide);
+	// True if the only blocked unit, if any, within the bounds of the free field stencil placed at blockerIndex is the blocker itself
+	bool freeFieldIsClear(const Point_Int& blockerIndex) const;
 
-	// Finds the centers of all cubic subdivisions of the unit whose center is at vectorToUnit within shade range.  The number
-	// of potential subdivisions is 8^timesToDivide
-	std::vector<MVector> getSubDivisionsInShadeRange(const MVector& vectorToUnit, int timesToDivide);
+	// Sets the unit's blocked state and keeps blockedUnitsByCell up to date
+	void setUnitBlocked(GridUnit unit, bool blocked);
+
+	// Find all ShadeVectors in shade range and add the subdivisions of their canonical counterparts to canonicalSubdivisions.  This also sets each
+	// ShadeVector's face-adjacent neighbors and adds every ShadeVector found to allShadeVectors
+	void findAllShadeVectorSubdivisions(std::unordered_map<Point_Int, std::vector<Subdivision>, Point_Int::HashFunction>& canonicalSubdivisions,
+		std::unordered_map<ShadeVector*, std::vector<Subdivision>>& totalOccludedVolumesByShadeVectors, std::vector<ShadeVector*>& allShadeVectors,
+		double minSubdivisionSize);
+
+	// Finds the cubic subdivisions of the unit whose center is at vectorToUnit that are within shade range.  Subdivisions entirely inside of
+	// shade range are kept whole, and only those straddling its edge are divided further, down to minSubdivisionSize.
+	std::vector<Subdivision> getSubDivisionsInShadeRange(const MVector& vectorToUnit, double minSubdivisionSize) const;
+
+	// Recursive step of getSubDivisionsInShadeRange.  Adds the parts of subdivision that are within shade range to subdivisionsInRange.
+	void findSubdivisionsInShadeRange(const Subdivision& subdivision, double minSubdivisionSize, std::vector<Subdivision>& subdivisionsInRange) const;
+
+	// Returns the subdivisions in shade range of the canonical counterpart of the unit at toUnit, finding them with getSubDivisionsInShadeRange
+	// and keeping them in canonicalSubdivisions the first time they are needed.  Only units in the canonical octant are ever subdivided.
+	const std::vector<Subdivision>& getCanonicalSubdivisionsInShadeRange(const Point_Int& toUnit, double minSubdivisionSize,
+		std::unordered_map<Point_Int, std::vector<Subdivision>, Point_Int::HashFunction>& canonicalSubdivisions) const;
+
+	// Returns the subdivisions in shade range of the unit at toUnit.  Those of a canonical unit are returned as they are kept, and those of any other
+	// unit are mirrored from its canonical counterpart's into mirroredSubdivisions, which is overwritten.
+	const std::vector<Subdivision>& getSymmetricSubdivisionsInShadeRange(const Point_Int& toUnit,
+		const std::unordered_map<Point_Int, std::vector<Subdivision>, Point_Int::HashFunction>& canonicalSubdivisions, std::vector<Subdivision>& mirroredSubdivisions) const;
+
+	static double getTotalVolume(const std::vector<Subdivision>& subdivisions);
 
 	// Calculates the total volume blocked for all ShadeVectors, as well as maxVolumeBlocked (this is the total volume blocked by shadeRoot)
-	// Also does the initial calculation of the amount of occluded volume shared by parents and their children
-	void findAllShadedVolume(ShadeVector* shadeVector,
-		std::unordered_map< ShadeVector*, std::vector<MVector>>& subdivisionsByUnit,
-		std::unordered_map<ShadeVector*, std::vector<MVector>>& totalOccludedVolumesByShadeVectors,
-		std::unordered_set<ShadeVector*>& done, double subdivisionVolume, double subdivisionSize);
+	// Also does the initial calculation of the amount of occluded volume shared by parents and their children.  The work is spread over threadCount threads.
+	// Only the ShadeVectors in the canonical octant are computed.  The rest are mirror images and copy their values.
+	void findAllShadedVolume(const std::vector<ShadeVector*>& allShadeVectors,
+		const std::unordered_map<Point_Int, std::vector<Subdivision>, Point_Int::HashFunction>& canonicalSubdivisions,
+		std::unordered_map<ShadeVector*, std::vector<Subdivision>>& totalOccludedVolumesByShadeVectors, double minSubdivisionSize);
+
+	// Sets the volumeBlocked and shadeVector of one ShadeVector, adding the subdivisions it occludes to occludedSubdivisions.  Safe to run concurrently
+	// for different ShadeVectors.
+	void computeVolumeBlocked(ShadeVector* shadeVector, const std::unordered_map<Point_Int, std::vector<Subdivision>, Point_Int::HashFunction>& canonicalSubdivisions,
+		std::vector<Subdivision>& occludedSubdivisions, double minSubdivisionSize) const;
+
+	// Adds the volume of the subdivisions of the unit at toUnit that lie in the frustrum beyond the blocker, adding them to subdivisionsInVolume.  Units found
+	// to be entirely inside or outside of the frustrum are handled as a whole, and only those straddling its edge have their subdivisions tested.  The unit's
+	// subdivisions are mirrored into mirroredSubdivisions from canonicalSubdivisions only when they are needed.
+	double computeShadedVolumeOfUnit(const Point_Int& blockerToUnit, const FacingSides& blockerUnitSidesFacingOrigin, const Point_Int& toUnit,
+		const std::unordered_map<Point_Int, std::vector<Subdivision>, Point_Int::HashFunction>& canonicalSubdivisions, std::vector<Subdivision>& mirroredSubdivisions,
+		std::vector<Subdivision>& subdivisionsInVolume, const double minSubdivisionSize) const;
+
+	// A conservative test of the whole unit at toUnit against the frustrum beyond the blocker.  insideFrustum and outsideFrustum are only returned
+	// when they hold for every point of the unit.
+	frustumOverlap getUnitOverlapWithFrustum(const Point_Int& blockerToUnit, const FacingSides& blockerUnitSidesFacingOrigin, const Point_Int& toUnit) const;
+
+	// Sets the sharedBlockage and percentShared for each of the canonical ShadeVector's children.  Requires computeVolumeBlocked to have finished for all
+	// canonical ShadeVectors and volumeBlocked to have been copied to the rest.
+	void computeVolumeSharedWithNeighbors(ShadeVector* shadeVector, const std::unordered_map<Point_Int, ShadeVector*, Point_Int::HashFunction>& shadeVectorsByToUnit,
+		const std::unordered_map<ShadeVector*, std::vector<Subdivision>>& totalOccludedVolumesByShadeVectors, double minSubdivisionSize) const;
+
+	// Sets the sharedBlockage and percentShared for each child of a non-canonical ShadeVector from the matching child of its canonical counterpart
+	void copySharedVolumeFromCanonical(ShadeVector* shadeVector, const std::unordered_map<Point_Int, ShadeVector*, Point_Int::HashFunction>& shadeVectorsByToUnit) const;
 
 	/*
 		We will be drawing a ray from each subdivision of each unit neighboring the sv and checking for intersection with it.
@@ -161,18 +352,20 @@ class BlockPointGrid {
 		be determined easily by looking at toUnit.  If a dimension of toUnit has non-zero value, then it may be intersected, in which case
 		we will need the normal of the unit's side facing the shade root in that dimension as well as the point at the center of that side.
 	*/
-	std::vector<std::pair<MVector, MVector>> getUnitSidesFacingShadeOrigin(const ShadeVector& sv) const;
+	FacingSides getUnitSidesFacingShadeOrigin(const Point_Int& toUnit) const;
 
 	// Given a blocker ShadeVector, represented with just some of its sides, and the subdivisions of one of the descendant ShadeVector units that it blocks,
 	// calculate the portion of the volume of the descendant that lies in the frustrum beyond the blocker.
-	double computeShadedVolume(const std::vector<std::pair<MVector, MVector>>& blockerUnitSidesFacingOrigin,
-		const std::vector<MVector>& neighborSubdivisions, std::vector<MVector>& subdivisionsInVolume,
-		const double subdivisionSize, const double subdivisionVolume);
+	double computeShadedVolume(const FacingSides& blockerUnitSidesFacingOrigin,
+		const std::vector<Subdivision>& neighborSubdivisions, std::vector<Subdivision>& subdivisionsInVolume, const double minSubdivisionSize) const;
 
-	bool pointOfIntersectionIsOnSide(const MPoint& pointOfIntersection, const MVector& sideNorm, const MVector& sideCenter, const MVector& ray) const;
+	// Calculates the portion of count subdivisions' volume that lies in the frustrum beyond the blocker.  Subdivisions straddling the edge of the frustrum
+	// are divided further, down to minSubdivisionSize.  If subdivisionsInVolume is not null, the shaded parts are added to it.
+	double computeShadedVolume(const FacingSides& blockerUnitSidesFacingOrigin, const Subdivision* subdivisions, std::size_t count,
+		const double minSubdivisionSize, std::vector<Subdivision>* subdivisionsInVolume) const;
 
-	double findVolumeSharedWithNeighbor(const std::vector<std::pair<MVector, MVector>>& blockerUnitSidesFacingOrigin,
-		const std::vector<MVector>& shadedSubdivisions, const double subdivisionSize, const double subdivisionVolume);
+	double findVolumeSharedWithNeighbor(const FacingSides& blockerUnitSidesFacingOrigin,
+		const std::vector<Subdivision>& shadedSubdivisions, const double minSubdivisionSize) const;
 
 	/*
 	* The initial calculation of the volume a ShadeVector blocks of each of its neighbors will be inaccurate because
@@ -186,8 +379,7 @@ class BlockPointGrid {
 
 	static void divideCubeToEighths(const MVector& cubeCenter, double size, std::vector<MVector>& subdivisions);
 
-	void displayShadeVectorUnitsByLevel(double subdivisionSize,
-		std::unordered_map<ShadeVector*, std::vector<MVector>>& totalOccludedVolumesByShadeVectors);
+	void displayShadeVectorUnitsByLevel(std::unordered_map<ShadeVector*, std::vector<Subdivision>>& totalOccludedVolumesByShadeVectors);
 
 	void createShadeVectorUnitTransform(MObject& handle, ShadeVector* sv, MFnDagNode& debugGroupDagNodeFn,
 		std::unordered_map<ShadeVector*, std::map<std::string, ChannelGroup>>& shadeVectorChannels);
@@ -197,18 +389,52 @@ class BlockPointGrid {
 	// Checks that each index is within the range of the grid and output an error message if not
 	inline bool indicesAreInRange_showError(int x, int y, int z) const;
 
-	// Adds moveVector to each index in indicesInRadius to form a new set of indices in radius.  Also finds the set difference with respect to both new and old index sets
-	MStatus addMoveVectorToBP(BlockPoint& bp, const Point_Int& moveVector, std::vector<Point_Int>& newSetDiff, std::vector<Point_Int>& oldSetDiff);
+	// Adds a block point, with its coverage stencil, without adjusting any units.  unitIndex must be on the grid.
+	BlockPointHandle createBlockPoint(const MPoint& loc, double bpDensity, double bpRadius, const Point_Int& unitIndex);
+
+	// Adjusts the densities of the units bp's coverage stencil stops or starts covering when bp moves by moveVector.  bp's grid index is not changed.
+	void addMoveVectorToBP(const BlockPoint& bp, const Point_Int& moveVector);
+
+	// Calls stamp(i, deltas) for every i in [0, count), in parallel chunks, and returns the deltas it adds summed per unit.  Units whose deltas
+	// cancel out are left out.  stamp must only read the grid.
+	std::vector<DensityDelta> gatherDensityDeltas(std::size_t count, const std::function<void(std::size_t, std::vector<DensityDelta>&)>& stamp) const;
+
+	// Adjusts the density of the units from zBegin up to zEnd in the row at x, y by adj and marks them dirty
+	void adjustCoverageRun(int x, int y, int zBegin, int zEnd, int adj);
+
+	// Sorts deltas by key and replaces each run of deltas to the same unit with their sum, dropping sums of zero
+	static void combineDensityDeltas(std::vector<DensityDelta>& deltas);
+
+	// Adjusts the density of each unit in deltas and marks it dirty
+	void applyDensityDeltas(const std::vector<DensityDelta>& deltas);
+
+	// Finds the linear indices of the eight units around (px, py, pz), ordered as LightCorners' corners, and how far the point is from the first
+	// toward the last along each axis
+	void findLightCell(double px, double py, double pz, std::uint32_t (&cellCorners)[8], double (&fraction)[3]) const;
+
+	// Fills point i of corners with the light conditions of the eight units around (px, py, pz) and where the point lies between them
+	void gatherLightCorners(double px, double py, double pz, LightCorners& corners, std::size_t i) const;
+
+	void markLightStale(std::uint32_t i);
+
+	// Evaluates the light conditions of the units in unitIndices that are stale with the evaluateLightConditions kernel, and marks them current
+	void evaluateStaleUnits(const std::vector<std::uint32_t>& unitIndices);
+
+	// Updates the unit's cube and arrow meshes to its light conditions, making or hiding them as the display settings call for
+	void updateUnitDisplay(GridUnit& unit);
 
 	void setShadingGroups();
 
-	// Performs a BFS, radiating from bpUnitIndex to any units whose center's distance from bpLoc is less than radius
-	// Consider further optimizing this.  Since the radius doesn't change for a given order, it seems like maybe we can do this only once for each order and store a
-	// list of vectors to units within the radius.  Note that bpLoc does change, however, which might mean this optimization could only at best be an approximation.
-	std::unordered_set<Point_Int, Point_Int::HashFunction> getIndicesInRadius(const MPoint& bpLoc, const Point_Int bpUnitIndex, const double radius);
+	// Returns the stencil of units whose center's distance from bpLoc is less than radius, as offsets from bpUnitIndex.  bpLoc's position within
+	// its unit and the radius are quantized, so block points with similar radii and positions share a stencil.
+	const CoverageStencil* getCoverageStencil(const MPoint& bpLoc, const Point_Int bpUnitIndex, const double radius);
 
-	// A list of integer vectors to adjacent units.  Can be used to optimize finding units within a BlockPoint's radius
-	const std::vector<Point_Int> UNIT_NEIGHBOR_DIRECTIONS{ {-1,0,0 }, {1,0,0}, {0,-1,0}, {0,1,0}, {0,0,-1}, {0,0,1} };
+	// Calls func(index) for every unit on the grid that bp covers
+	template <typename Func>
+	void forEachCoveredIndex(const BlockPoint& bp, Func func) const {
+
+		bp.getCoverage()->forEachIndex(bp.getGridIndex(), xElements, yElements, zElements, func);
+	}
 
 	// Index vectors to neighboring units on sides and below.
 	const std::vector<Point_Int> VECTORS_TO_NEIGHBORS = {
@@ -224,7 +450,11 @@ public:
 	BlockPointGrid() {}
 
 	// If x, y, or z size doesn't divide evenly by unit size they will be increased to accomodate
-	BlockPointGrid(int id, double XSIZE, double YSIZE, double ZSIZE, double UNITSIZE, const MPoint base, double DETECTIONRANGE, double CONERANGEANGLE, double INTENSITY);
+	// SUBDIVISIONDEPTH is the maximum number of times a unit is divided into eighths when approximating volumes for the ShadeVector graph
+	// THREADS is the number of threads used to build the ShadeVector graph and propagate shade, where 0 means one per hardware thread
+	// If SPARSE is true, units are only allocated once block points or shade reach them
+	BlockPointGrid(int id, double XSIZE, double YSIZE, double ZSIZE, double UNITSIZE, const MPoint base, double DETECTIONRANGE, double CONERANGEANGLE, double INTENSITY,
+		int SUBDIVISIONDEPTH, unsigned int THREADS, bool SPARSE);
 
 	~BlockPointGrid();
 
@@ -236,6 +466,8 @@ public:
 
 	static double INTENSITY_DEFAULT() { return .1; }
 
+	static int SUBDIVISION_DEPTH_DEFAULT() { return 3; }
+
 	void startAuxTimer() { auxiliaryTimer = clock(); }
 
 	double getTime() const {
@@ -249,23 +481,152 @@ public:
 	// Checks that each index is within the range of the grid
 	inline bool indicesAreOnGrid(int x, int y, int z) const;
 
+	// Handles to the unit at the given grid index or linear index in units.  Reading a unit's light conditions through a handle evaluates them
+	// first if they are stale, like getShadePercentage and getLightDirection do.
+	GridUnit unitAt(int x, int y, int z) { return GridUnit(units, units.linearIndex(x, y, z)); }
+	GridUnit unitAt(std::uint32_t i) { return GridUnit(units, i); }
+
+	/*
+		Samples the light field at count points, whose coordinates are given in the separate arrays x, y, and z.  Each point's shade and light
+		direction are blended trilinearly from the eight unit centers around it, and written to shade[i] and lightX[i], lightY[i], lightZ[i].
+		Points beyond the outermost unit centers take the conditions at the grid's edge, and units that haven't been allocated are fully lit.
+
+		The blend runs several points at a time with SIMD, and batches of at least MIN_PARALLEL_LIGHT_QUERIES points are split between
+		threads.  Reads light conditions as of the last applyShade, evaluating any stale units around the points first.
+	*/
+	void queryLight(const double* x, const double* y, const double* z, std::size_t count, double* shade, double* lightX, double* lightY, double* lightZ);
+
+	// The light conditions of the unit at a grid index, which are evaluated first if they are stale.  Units that haven't been allocated are fully lit.
+	double getShadePercentage(int x, int y, int z);
+	MVector getLightDirection(int x, int y, int z);
+
+	/*
+		Turns lazy light conditions on or off.  While on, applyShade only marks the units whose light conditions it changed as stale, and each
+		is evaluated when it is first read, through getShadePercentage, getLightDirection, queryLight, or a GridUnit's getters, or when a region
+		it is in is flushed.  Fields read straight from the GridUnitStore are not evaluated first.  Useful during interactive edits, when only a few of the units
+		an edit touches are ever looked at before the next one.  Turning it off evaluates every stale unit.
+	*/
+	void setLazyLightConditions(bool lazy);
+	bool hasLazyLightConditions() const { return lazyLightConditions; }
+
+	// Evaluates the light conditions of every stale unit
+	void flushLightConditions();
+
+	// Evaluates the light conditions of the stale units from startInd up to, but not including, endInd
+	void flushLightConditions(const Point_Int& startInd, const Point_Int& endInd);
+
 	// Creates a new BlockPoint and adjusts any affected units.  
-	// The pointer reference is for Segments' pointers to their BlockPoints - they are the only handles to BlockPoints that exist
+	// The handle reference is for Segments' handles to their BlockPoints - they are the only handles to BlockPoints that exist
 	// outside of the BlockPointGrid
-	MStatus addBlockPoint(const MPoint loc, double bpDensity, double bpRadius, std::shared_ptr<BlockPoint>& ptrForSeg);
+	MStatus addBlockPoint(const MPoint loc, double bpDensity, double bpRadius, BlockPointHandle& handleForSeg);
+
+	// Returns the block point, or nullptr if it has been deleted.  The pointer is only valid until the next block point is added or deleted.
+	BlockPoint* getBlockPoint(const BlockPointHandle& handle) { return blockPoints.get(handle); }
 
 	// Moves the passed BlockPoint to the new location.  Subtracts its effects from previously affected units and adds its effects to newly affected ones
 	MStatus moveBlockPoint(BlockPoint& bp, const MPoint newLoc);
 
-	// Removes one block point from the grid's blockPoints list and adjusts the density of the unit it occupied
-	void deleteBlockPoint(std::shared_ptr<BlockPoint> bp);
+	// Removes one block point from the grid's blockPoints and adjusts the density of the units it covered.  Does nothing if it was already deleted.
+	void deleteBlockPoint(const BlockPointHandle& handle);
 
 	// Calls deleteBlockPoint for all block points in blockPoints. Also deletes the block point's mesh if it has one
 	MStatus deleteAllBlockPoints();
 
-	bool hasBlockPoint(std::shared_ptr<BlockPoint>& bp) {
+	bool hasBlockPoint(const BlockPointHandle& handle) const { return blockPoints.contains(handle); }
+
+	// Returns the handle of the block point with the id, which is stale if there is no such block point
+	BlockPointHandle findBlockPoint(int bpId) const {
+
+		auto it = blockPointIds.find(bpId);
+		return it == blockPointIds.end() ? BlockPointHandle() : it->second;
+	}
+
+	/*
+		Bulk versions of addBlockPoint, moveBlockPoint, and deleteBlockPoint for many block points at once.  The units each block point covers
+		are gathered in parallel, and the density changes to each unit are summed before any are applied, so units covered by many of the
+		block points are only adjusted once.  Like the single versions, these leave the changes to be shaded by the next applyShade.
+
+		densities and radii hold either one value for each location or a single value for all of them.  Locations that are off the grid are
+		skipped, and get a stale handle, and moves to them are skipped.  Both return kFailure if any were skipped.  Stale handles are ignored,
+		as are repeats of a handle.
+	*/
+	MStatus addBlockPoints(const std::vector<MPoint>& locs, const std::vector<double>& densities, const std::vector<double>& radii, std::vector<BlockPointHandle>& handles);
+
+	MStatus moveBlockPoints(const std::vector<BlockPointHandle>& handles, const std::vector<MPoint>& newLocs);
+
+	void deleteBlockPoints(const std::vector<BlockPointHandle>& handles);
+
+	/*
+		Adds a capsule occluder covering every unit whose center is within radius of the segment from start to end, and adjusts the density
+		of the units it covers.  Parts of the capsule that are off the grid are ignored.  Like addBlockPoint, this leaves the change to be
+		shaded by the next applyShade.
+	*/
+	MStatus addCapsule(const MPoint& start, const MPoint& end, double radius, double density, CapsuleHandle& handle);
+
+	// Moves the capsule's endpoints, adjusting only the units it stops or starts covering
+	MStatus moveCapsule(const CapsuleHandle& handle, const MPoint& newStart, const MPoint& newEnd);
+
+	// Removes the capsule and adjusts the density of the units it covered.  Does nothing if it was already deleted.
+	void deleteCapsule(const CapsuleHandle& handle);
+
+	bool hasCapsule(const CapsuleHandle& handle) const { return capsules.contains(handle); }
+
+	// Returns the capsule, or nullptr if it has been deleted.  The pointer is only valid until the next capsule is added or deleted.
+	const CapsuleOccluder* getCapsule(const CapsuleHandle& handle) const { return capsules.get(handle); }
+
+	/*
+		Voxelizes a triangle mesh into the grid and adds density to every unit it covers.  vertices holds the x, y, and z of each vertex and
+		indices the three vertex indices of each triangle.  The surface covers every unit it touches, and if solid is true, units inside the
+		mesh are covered as well, which requires it to be closed.  Voxelization is done in parallel, and like addBlockPoint this leaves the
+		change to be shaded by the next applyShade, so a whole mesh is imported with one applyShade.  Returns kInvalidParameter, adding nothing,
+		if the buffers don't come in threes, an index is out of range, or a vertex isn't finite.
+	*/
+	MStatus addMesh(const std::vector<float>& vertices, const std::vector<std::uint32_t>& indices, double density, bool solid, MeshHandle& handle);
+
+	// Removes the mesh and the density it added.  Does nothing if it was already deleted.
+	void deleteMesh(const MeshHandle& handle);
+
+	bool hasMesh(const MeshHandle& handle) const { return meshes.contains(handle); }
+
+	// Returns the handle of the mesh with the id, which is stale if there is no such mesh
+	MeshHandle findMesh(int id) const {
+
+		auto it = meshIds.find(id);
+		return it == meshIds.end() ? MeshHandle() : it->second;
+	}
+
+	// Returns the id of the mesh, or -1 if it has been deleted
+	int getMeshId(const MeshHandle& handle) const {
+
+		const OccluderMesh* mesh = meshes.get(handle);
+		return mesh ? mesh->id : -1;
+	}
+
+	/*
+		Loads a point cloud file, as described in PointCloudLoader.h, and adds density to every unit it covers.  If hasRadius is true, each
+		point covers the units within its radius like a block point does, otherwise it covers only the unit it is in.  Units covered by more
+		than one point get density only once.  The points are binned and their coverage gathered in parallel, and the result is applied as one
+		batch that is shaded by the next applyShade.
+	*/
+	MStatus addPointCloud(const std::string& path, bool hasRadius, double density, PointCloudHandle& handle);
+
+	// Removes the point cloud and the density it added.  Does nothing if it was already deleted.
+	void deletePointCloud(const PointCloudHandle& handle);
+
+	bool hasPointCloud(const PointCloudHandle& handle) const { return pointClouds.contains(handle); }
+
+	// Returns the handle of the point cloud with the id, which is stale if there is no such point cloud
+	PointCloudHandle findPointCloud(int id) const {
+
+		auto it = pointCloudIds.find(id);
+		return it == pointCloudIds.end() ? PointCloudHandle() : it->second;
+	}
+
+	// Returns the id of the point cloud, or -1 if it has been deleted
+	int getPointCloudId(const PointCloudHandle& handle) const {
 
-		return std::find(blockPoints.begin(), blockPoints.end(), bp) != blockPoints.end();
+		const OccluderPointCloud* pointCloud = pointClouds.get(handle);
+		return pointCloud ? pointCloud->id : -1;
 	}
 
 	void updateAllUnitsLightConditions();
@@ -289,7 +650,7 @@ public:
 	}
 
 	// Adds callbacks to the bps passed.  These will alter the grid state when block points are moved or removed
-	void attachBPCallbacks(std::vector<std::shared_ptr<BlockPoint>> bps);
+	void attachBPCallbacks(const std::vector<BlockPointHandle>& bps);
 
 	// Triggers when blockpoints are moved in the Maya viewport. 
 	static void updateGridFromBPChange(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData);
@@ -298,7 +659,7 @@ public:
 	static void updateGridAfterBPRemoval(MObject& node, void* clientData);
 
 	// Display the block points passed.
-	void displayBlockPoints(std::vector<std::shared_ptr<BlockPoint>> bpsToDisplay);
+	void displayBlockPoints(const std::vector<BlockPointHandle>& bpsToDisplay);
 
 	// Can be used as a toggle.  If d is true, displays block point meshes, otherwise hides them
 	void displayAllBlockPoints(bool d);
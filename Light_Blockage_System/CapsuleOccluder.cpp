@@ -0,0 +1,176 @@
+#include <cmath>
+#include <limits>
+
+#include "CapsuleOccluder.h"
+
+namespace {
+
+	const double EPSILON = 1e-12;
+
+	struct Vec3 {
+
+		double x;
+		double y;
+		double z;
+
+		Vec3 operator-(const Vec3& rhs) const { return { x - rhs.x, y - rhs.y, z - rhs.z }; }
+		Vec3 operator/(double scalar) const { return { x / scalar, y / scalar, z / scalar }; }
+		double operator*(const Vec3& rhs) const { return (x * rhs.x) + (y * rhs.y) + (z * rhs.z); }
+		double length() const { return std::sqrt((x * x) + (y * y) + (z * z)); }
+	};
+
+	// Widens [lo, hi] to include where the line through (cx, cy) along z is within radius of center
+	void addSphereInterval(const Vec3& center, double radius, double cx, double cy, double& lo, double& hi) {
+
+		double dx = cx - center.x;
+		double dy = cy - center.y;
+		double halfChordSquared = (radius * radius) - (dx * dx) - (dy * dy);
+
+		if (halfChordSquared > 0.) {
+
+			double halfChord = std::sqrt(halfChordSquared);
+			lo = std::min(lo, center.z - halfChord);
+			hi = std::max(hi, center.z + halfChord);
+		}
+	}
+
+	// Widens [lo, hi] to include where the line through (cx, cy) along z is within radius of the segment's axis, between its ends
+	void addCylinderInterval(const Vec3& a, const Vec3& axis, double length, double radius, double cx, double cy, double& lo, double& hi) {
+
+		// Points on the line are w0 + t * (0, 0, 1) relative to a.  Their squared distance from the axis is
+		// |w|^2 - (w . axis)^2 = qa * t^2 + qb * t + qc + radius^2, and they lie between the ends when 0 <= w . axis <= length.
+		Vec3 w0 = { cx - a.x, cy - a.y, -a.z };
+		double w0Axis = w0 * axis;
+
+		double qa = 1. - (axis.z * axis.z);
+		double qb = 2. * (w0.z - (w0Axis * axis.z));
+		double qc = (w0 * w0) - (w0Axis * w0Axis) - (radius * radius);
+
+		double inRadiusLo = -std::numeric_limits<double>::infinity();
+		double inRadiusHi = std::numeric_limits<double>::infinity();
+
+		if (qa < EPSILON) {
+
+			// The axis runs along z, so the whole line is either within radius or not
+			if (qc >= 0.)
+				return;
+		}
+		else {
+
+			double discriminant = (qb * qb) - (4. * qa * qc);
+			if (discriminant <= 0.)
+				return;
+
+			double root = std::sqrt(discriminant);
+			inRadiusLo = (-qb - root) / (2. * qa);
+			inRadiusHi = (-qb + root) / (2. * qa);
+		}
+
+		double betweenEndsLo = -std::numeric_limits<double>::infinity();
+		double betweenEndsHi = std::numeric_limits<double>::infinity();
+
+		if (std::abs(axis.z) < EPSILON) {
+
+			// The axis is perpendicular to the line, so the whole line is either between the ends or not
+			if (w0Axis < 0. || w0Axis > length)
+				return;
+		}
+		else {
+
+			double t0 = -w0Axis / axis.z;
+			double t1 = (length - w0Axis) / axis.z;
+			betweenEndsLo = std::min(t0, t1);
+			betweenEndsHi = std::max(t0, t1);
+		}
+
+		double intervalLo = std::max(inRadiusLo, betweenEndsLo);
+		double intervalHi = std::min(inRadiusHi, betweenEndsHi);
+
+		if (intervalLo < intervalHi) {
+
+			lo = std::min(lo, intervalLo);
+			hi = std::max(hi, intervalHi);
+		}
+	}
+}
+
+void CapsuleOccluder::rasterize(const double firstCenter[3], double unitSize, int X, int Y, int Z, std::vector<CoverageRun>& runs) const {
+
+	runs.clear();
+
+	// Work in grid index space, where the center of the unit at index (x, y, z) is the point (x, y, z)
+	Vec3 origin = { firstCenter[0], firstCenter[1], firstCenter[2] };
+	Vec3 a = (Vec3{ start[0], start[1], start[2] } - origin) / unitSize;
+	Vec3 b = (Vec3{ end[0], end[1], end[2] } - origin) / unitSize;
+	double r = radius / unitSize;
+
+	Vec3 axis = b - a;
+	double length = axis.length();
+	bool hasCylinder = length > EPSILON;
+	if (hasCylinder)
+		axis = axis / length;
+
+	int aX = static_cast<int>(std::floor(a.x + .5));
+	int aY = static_cast<int>(std::floor(a.y + .5));
+	int aZ = static_cast<int>(std::floor(a.z + .5));
+	int bX = static_cast<int>(std::floor(b.x + .5));
+	int bY = static_cast<int>(std::floor(b.y + .5));
+	int bZ = static_cast<int>(std::floor(b.z + .5));
+
+	int xBegin = std::max(0, std::min(std::min(aX, bX), static_cast<int>(std::ceil(std::min(a.x, b.x) - r))));
+	int xEnd = std::min(X, std::max(std::max(aX, bX), static_cast<int>(std::floor(std::max(a.x, b.x) + r))) + 1);
+	int yBegin = std::max(0, std::min(std::min(aY, bY), static_cast<int>(std::ceil(std::min(a.y, b.y) - r))));
+	int yEnd = std::min(Y, std::max(std::max(aY, bY), static_cast<int>(std::floor(std::max(a.y, b.y) + r))) + 1);
+
+	for (int x = xBegin; x < xEnd; ++x) {
+		for (int y = yBegin; y < yEnd; ++y) {
+
+			// The capsule is convex, so the part of this row within it is a single interval: the union of the intervals within each end's
+			// sphere and within the cylinder between them
+			double lo = std::numeric_limits<double>::infinity();
+			double hi = -std::numeric_limits<double>::infinity();
+
+			addSphereInterval(a, r, x, y, lo, hi);
+			addSphereInterval(b, r, x, y, lo, hi);
+			if (hasCylinder)
+				addCylinderInterval(a, axis, length, r, x, y, lo, hi);
+
+			int zBegin = 0;
+			int zEnd = 0;
+
+			// Unit centers strictly inside the interval
+			if (lo < hi) {
+
+				zBegin = static_cast<int>(std::floor(lo)) + 1;
+				zEnd = static_cast<int>(std::ceil(hi));
+			}
+
+			// The endpoints' own units are always covered, however thin the capsule
+			bool coversA = x == aX && y == aY;
+			bool coversB = x == bX && y == bY;
+			if (zBegin >= zEnd && (coversA || coversB)) {
+
+				zBegin = coversA ? aZ : bZ;
+				zEnd = zBegin + 1;
+			}
+
+			if (coversA) {
+
+				zBegin = std::min(zBegin, aZ);
+				zEnd = std::max(zEnd, aZ + 1);
+			}
+
+			if (coversB) {
+
+				zBegin = std::min(zBegin, bZ);
+				zEnd = std::max(zEnd, bZ + 1);
+			}
+
+			zBegin = std::max(zBegin, 0);
+			zEnd = std::min(zEnd, Z);
+
+			if (zBegin < zEnd)
+				runs.push_back({ x, y, zBegin, zEnd });
+		}
+	}
+}
@@ -0,0 +1,107 @@
+/*
+	A capsule shaped occluder: every point within radius of the segment between two endpoints.  A single capsule can stand in for a whole
+	branch segment that would otherwise take a row of BlockPoints.
+
+	Like a BlockPoint, a capsule covers every unit whose center is within its radius, and always covers the units its endpoints are in.  Its
+	coverage is found analytically, one row of units along z at a time, so building it costs one small calculation per row rather than a
+	distance check per unit.  Coverage is kept as runs of units along z, one per row, which is also what moving a capsule diffs against to
+	find the units it leaves and enters.  In a row an endpoint is in, the run stretches to reach the endpoint's unit, so a capsule thinner
+	than a unit covers the units between its endpoints when both are in the same row.  Points are passed as plain x, y, z arrays, and
+	nothing here depends on Maya.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "SlotMap.h"
+
+// The units from zBegin up to, but not including, zEnd in the row at x, y
+struct CoverageRun {
+
+	int x = 0;
+	int y = 0;
+	int zBegin = 0;
+	int zEnd = 0;
+};
+
+// Identifies a capsule in its grid.  Handles stay valid until the capsule is deleted.
+typedef SlotMapHandle CapsuleHandle;
+
+class CapsuleOccluder {
+
+	double start[3] = {};
+	double end[3] = {};
+	double radius = 1.;
+	int density = 1;
+
+	// Ordered by x, then y, with at most one run per row
+	std::vector<CoverageRun> coverage;
+
+public:
+
+	CapsuleOccluder(const double START[3], const double END[3], double RADIUS, int DENSITY) : radius(RADIUS), density(DENSITY) { setEndpoints(START, END); }
+
+	const double* getStart() const { return start; }
+	const double* getEnd() const { return end; }
+	double getRadius() const { return radius; }
+	int getDensity() const { return density; }
+
+	void setEndpoints(const double START[3], const double END[3]) { std::copy(START, START + 3, start); std::copy(END, END + 3, end); }
+
+	const std::vector<CoverageRun>& getCoverage() const { return coverage; }
+
+	// Replaces the coverage with runs, leaving the old coverage in runs so that its memory can be reused
+	void swapCoverage(std::vector<CoverageRun>& runs) { coverage.swap(runs); }
+
+	/*
+		Fills runs with the units of a grid of X by Y by Z units that the capsule covers.  firstCenter is the center of the grid's unit at
+		index (0, 0, 0).
+	*/
+	void rasterize(const double firstCenter[3], double unitSize, int X, int Y, int Z, std::vector<CoverageRun>& runs) const;
+
+	/*
+		Calls leaving(x, y, zBegin, zEnd) for every run of units covered by before but not by after, and entering(x, y, zBegin, zEnd) for
+		every run covered by after but not by before.  Both walk the two coverages together once.
+	*/
+	template <typename Leaving, typename Entering>
+	static void forEachCoverageDifference(const std::vector<CoverageRun>& before, const std::vector<CoverageRun>& after, Leaving leaving, Entering entering) {
+
+		auto rowLess = [](const CoverageRun& lhs, const CoverageRun& rhs) { return lhs.x != rhs.x ? lhs.x < rhs.x : lhs.y < rhs.y; };
+
+		// The parts of run outside of [zBegin, zEnd)
+		auto outside = [](const CoverageRun& run, int zBegin, int zEnd, auto func) {
+
+			if (run.zBegin < std::min(run.zEnd, zBegin))
+				func(run.x, run.y, run.zBegin, std::min(run.zEnd, zBegin));
+
+			if (std::max(run.zBegin, zEnd) < run.zEnd)
+				func(run.x, run.y, std::max(run.zBegin, zEnd), run.zEnd);
+		};
+
+		std::size_t b = 0;
+		std::size_t a = 0;
+
+		while (b < before.size() || a < after.size()) {
+
+			if (a == after.size() || (b < before.size() && rowLess(before[b], after[a]))) {
+
+				leaving(before[b].x, before[b].y, before[b].zBegin, before[b].zEnd);
+				++b;
+			}
+			else if (b == before.size() || rowLess(after[a], before[b])) {
+
+				entering(after[a].x, after[a].y, after[a].zBegin, after[a].zEnd);
+				++a;
+			}
+			else {
+
+				outside(before[b], after[a].zBegin, after[a].zEnd, leaving);
+				outside(after[a], before[b].zBegin, before[b].zEnd, entering);
+				++b;
+				++a;
+			}
+		}
+	}
+};
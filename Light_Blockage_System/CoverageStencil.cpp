@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cmath>
+
+#include "CoverageStencil.h"
+
+CoverageStencil::CoverageStencil(int RADIUSSTEPS, const Point_Int& SUBUNITSTEP) {
+
+	double radius = static_cast<double>(RADIUSSTEPS) / RADIUS_STEPS;
+
+	// Where the block point sits relative to its unit's center, in unit sizes
+	MVector loc = (SUBUNITSTEP.toMVector() + MVector(.5, .5, .5)) / SUB_UNIT_STEPS - MVector(.5, .5, .5);
+
+	// Every unit within the radius can be reached from the block point's unit by steps toward it that stay within the radius, so searching
+	// the bounding box finds the same units as a search spreading out from the block point's unit
+	int reach = static_cast<int>(std::ceil(radius)) + 1;
+
+	for (int x = -reach; x <= reach; ++x) {
+		for (int y = -reach; y <= reach; ++y) {
+			for (int z = -reach; z <= reach; ++z) {
+
+				bool isOrigin = x == 0 && y == 0 && z == 0;
+				if (isOrigin || (MVector(x, y, z) - loc).length() < radius)
+					offsets.push_back(Point_Int(x, y, z));
+			}
+		}
+	}
+
+	for (const Point_Int& offset : offsets) {
+
+		minOffset = Point_Int(std::min(minOffset.x, offset.x), std::min(minOffset.y, offset.y), std::min(minOffset.z, offset.z));
+		maxOffset = Point_Int(std::max(maxOffset.x, offset.x), std::max(maxOffset.y, offset.y), std::max(maxOffset.z, offset.z));
+	}
+}
+
+const CoverageStencil::MoveDifference* CoverageStencil::getMoveDifference(const Point_Int& move) const {
+
+	if (std::abs(move.x) > MAX_CACHED_MOVE || std::abs(move.y) > MAX_CACHED_MOVE || std::abs(move.z) > MAX_CACHED_MOVE)
+		return nullptr;
+
+	auto inserted = moveDifferences.try_emplace(moveKey(move));
+	MoveDifference& difference = inserted.first->second;
+
+	if (inserted.second) {
+
+		mergeMoveDifference(move,
+			[&](const Point_Int& offset) { difference.leaving.push_back(offset); },
+			[&](const Point_Int& offset) { difference.entering.push_back(offset); });
+	}
+
+	return &difference;
+}
+
+int CoverageStencil::radiusStep(double radiusInUnits) {
+
+	return std::max(static_cast<int>(std::round(radiusInUnits * RADIUS_STEPS)), 0);
+}
+
+double CoverageStencil::maxUsefulRadius(int X, int Y, int Z) {
+
+	// No unit center is further than the grid's diagonal from any point on the grid.  One more unit keeps the stencil's strict test of the
+	// radius from leaving out the farthest corner.
+	return std::sqrt((static_cast<double>(X) * X) + (static_cast<double>(Y) * Y) + (static_cast<double>(Z) * Z)) + 1.;
+}
+
+int CoverageStencil::subUnitStep(double offset) {
+
+	int step = static_cast<int>(std::floor((offset + .5) * SUB_UNIT_STEPS));
+	return std::min(std::max(step, 0), SUB_UNIT_STEPS - 1);
+}
+
+const CoverageStencil* CoverageStencilCache::get(double radiusInUnits, const MVector& subUnitOffset) {
+
+	int radiusSteps = CoverageStencil::radiusStep(std::min(radiusInUnits, maxRadiusInUnits));
+	Point_Int subUnitStep(CoverageStencil::subUnitStep(subUnitOffset.x), CoverageStencil::subUnitStep(subUnitOffset.y),
+		CoverageStencil::subUnitStep(subUnitOffset.z));
+
+	std::uint64_t key = (static_cast<std::uint64_t>(radiusSteps) << 16) | (subUnitStep.x << 8) | (subUnitStep.y << 4) | subUnitStep.z;
+
+	std::unique_ptr<CoverageStencil>& stencil = stencils[key];
+	if (!stencil)
+		stencil = std::make_unique<CoverageStencil>(radiusSteps, subUnitStep);
+
+	return stencil.get();
+}
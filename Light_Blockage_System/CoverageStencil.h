@@ -0,0 +1,201 @@
+/*
+	The grid indices a block point covers, as offsets from the unit the block point is in.  Which units a block point covers depends only on its
+	radius and where it sits within its unit, both measured in unit sizes, so stencils are built once for each radius and quantized sub-unit
+	position and shared by every block point that matches them.  Covering units is then a walk over a precomputed list rather than a search.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <maya/MVector.h>
+
+#include "Point_Int.h"
+
+class CoverageStencil {
+
+	// Offsets from the block point's unit of every unit whose center is within the radius, ordered x, then y, then z.  Always includes (0, 0, 0).
+	std::vector<Point_Int> offsets;
+
+	// The smallest and largest offset along each axis
+	Point_Int minOffset;
+	Point_Int maxOffset;
+
+public:
+
+	// Offsets, from a block point's unit before it moves, of the units it stops covering and starts covering when it moves
+	struct MoveDifference {
+
+		std::vector<Point_Int> leaving;
+		std::vector<Point_Int> entering;
+	};
+
+private:
+
+	// Differences for small moves, keyed by moveKey.  Built the first time each move is made.
+	mutable std::unordered_map<std::uint32_t, MoveDifference> moveDifferences;
+
+	static bool lexicographicallyLess(const Point_Int& lhs, const Point_Int& rhs) {
+
+		if (lhs.x != rhs.x)
+			return lhs.x < rhs.x;
+
+		if (lhs.y != rhs.y)
+			return lhs.y < rhs.y;
+
+		return lhs.z < rhs.z;
+	}
+
+	static std::uint32_t moveKey(const Point_Int& move) {
+
+		const int width = (2 * MAX_CACHED_MOVE) + 1;
+		return static_cast<std::uint32_t>((((move.x + MAX_CACHED_MOVE) * width) + (move.y + MAX_CACHED_MOVE)) * width + (move.z + MAX_CACHED_MOVE));
+	}
+
+public:
+
+	// Moves of up to this many units along every axis have their differences cached
+	static const int MAX_CACHED_MOVE = 2;
+
+	// Radii are rounded to the nearest 1 / RADIUS_STEPS of a unit
+	static const int RADIUS_STEPS = 64;
+
+	// Positions within a unit are rounded to the center of one of SUB_UNIT_STEPS steps along each axis
+	static const int SUB_UNIT_STEPS = 8;
+
+	/*
+		RADIUSSTEPS is the radius in steps of 1 / RADIUS_STEPS unit sizes.  SUBUNITSTEP is the step along each axis, from 0 to SUB_UNIT_STEPS - 1,
+		of the block point's position within its unit.
+	*/
+	CoverageStencil(int RADIUSSTEPS, const Point_Int& SUBUNITSTEP);
+
+	// The number of 1 / RADIUS_STEPS unit sizes a radius of radiusInUnits unit sizes is rounded to.  radiusInUnits must be no more than
+	// maxUsefulRadius of the grid.
+	static int radiusStep(double radiusInUnits);
+
+	// The radius, in unit sizes, at which a stencil centered anywhere on a grid of X by Y by Z units covers all of it.  Any larger radius
+	// covers the same units, so radii are clamped to this before stencils are built for them.
+	static double maxUsefulRadius(int X, int Y, int Z);
+
+	// The step, from 0 to SUB_UNIT_STEPS - 1, that a position offset unit sizes from the center of its unit along one axis is rounded to
+	static int subUnitStep(double offset);
+
+	const std::vector<Point_Int>& getOffsets() const { return offsets; }
+
+	// Returns the difference for a move of up to MAX_CACHED_MOVE units along every axis, or nullptr for larger moves
+	const MoveDifference* getMoveDifference(const Point_Int& move) const;
+
+	/*
+		Calls leaving(offset) for every offset the stencil stops covering when moved by move, and entering(offset) for every one it starts
+		covering, both relative to where it was before the move.  Since the offsets are sorted, and stay sorted when shifted, this is a single
+		merge of the offsets with themselves.
+	*/
+	template <typename Leaving, typename Entering>
+	void mergeMoveDifference(const Point_Int& move, Leaving leaving, Entering entering) const {
+
+		std::size_t before = 0;
+		std::size_t after = 0;
+
+		while (before < offsets.size() || after < offsets.size()) {
+
+			if (after == offsets.size() || (before < offsets.size() && lexicographicallyLess(offsets[before], offsets[after] + move))) {
+
+				leaving(offsets[before++]);
+			}
+			else if (before == offsets.size() || lexicographicallyLess(offsets[after] + move, offsets[before])) {
+
+				entering(offsets[after++] + move);
+			}
+			else {
+
+				++before;
+				++after;
+			}
+		}
+	}
+
+	/*
+		Calls leaving(index) for every grid index the stencil stops covering when its center moves from origin to origin + move, and
+		entering(index) for every one it starts covering, skipping any that are off of a grid of X by Y by Z units.  Small moves walk cached
+		lists of the differences, larger ones merge the offsets.
+	*/
+	template <typename Leaving, typename Entering>
+	void forEachMovedIndex(const Point_Int& origin, const Point_Int& move, int X, int Y, int Z, Leaving leaving, Entering entering) const {
+
+		auto onGrid = [X, Y, Z](const Point_Int& index) {
+
+			return index.x >= 0 && index.x < X && index.y >= 0 && index.y < Y && index.z >= 0 && index.z < Z;
+		};
+
+		auto leaveOffset = [&](const Point_Int& offset) {
+
+			Point_Int index = origin + offset;
+			if (onGrid(index))
+				leaving(index);
+		};
+
+		auto enterOffset = [&](const Point_Int& offset) {
+
+			Point_Int index = origin + offset;
+			if (onGrid(index))
+				entering(index);
+		};
+
+		if (const MoveDifference* difference = getMoveDifference(move)) {
+
+			for (const Point_Int& offset : difference->leaving)
+				leaveOffset(offset);
+
+			for (const Point_Int& offset : difference->entering)
+				enterOffset(offset);
+		}
+		else {
+
+			mergeMoveDifference(move, leaveOffset, enterOffset);
+		}
+	}
+
+	/*
+		Calls func(index) for every grid index the stencil covers when centered on origin, skipping any that are off of a grid of X by Y by Z
+		units.  Stencils that fit entirely on the grid are walked without checking each index.
+	*/
+	template <typename Func>
+	void forEachIndex(const Point_Int& origin, int X, int Y, int Z, Func func) const {
+
+		bool fitsOnGrid = origin.x + minOffset.x >= 0 && origin.x + maxOffset.x < X &&
+			origin.y + minOffset.y >= 0 && origin.y + maxOffset.y < Y &&
+			origin.z + minOffset.z >= 0 && origin.z + maxOffset.z < Z;
+
+		for (const Point_Int& offset : offsets) {
+
+			Point_Int index = origin + offset;
+
+			if (fitsOnGrid || (index.x >= 0 && index.x < X && index.y >= 0 && index.y < Y && index.z >= 0 && index.z < Z))
+				func(index);
+		}
+	}
+};
+
+// Every stencil a grid has needed so far.  Stencils never move once built, so block points may keep pointers to them.
+class CoverageStencilCache {
+
+	std::unordered_map<std::uint64_t, std::unique_ptr<CoverageStencil>> stencils;
+
+	double maxRadiusInUnits = 0.;
+
+public:
+
+	// Sizes the cache for a grid of X by Y by Z units.  Must be called before get.
+	void setGridSize(int X, int Y, int Z) { maxRadiusInUnits = CoverageStencil::maxUsefulRadius(X, Y, Z); }
+
+	/*
+		Returns the stencil for a block point with a radius of radiusInUnits unit sizes, offset from the center of its unit by subUnitOffset
+		unit sizes, building it if it hasn't been needed before.  Radii beyond the grid's maxUsefulRadius are clamped to it.
+	*/
+	const CoverageStencil* get(double radiusInUnits, const MVector& subUnitOffset);
+
+	std::size_t size() const { return stencils.size(); }
+};
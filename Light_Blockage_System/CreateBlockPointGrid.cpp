@@ -89,11 +89,35 @@ MStatus CreateBlockPointGrid::doIt(const MArgList& argList) {
 	double halfConeAngle = argData.isFlagSet("-hca") ? argData.flagArgumentDouble("-hca", 0) : BlockPointGrid::HCA_DEFAULT();
 	double intensity = argData.isFlagSet("-i") ? argData.flagArgumentDouble("-i", 0) : BlockPointGrid::INTENSITY_DEFAULT();
 
+	int subdivisionDepth = argData.isFlagSet("-sd") ? argData.flagArgumentInt("-sd", 0) : BlockPointGrid::SUBDIVISION_DEPTH_DEFAULT();
+	if (subdivisionDepth < 1 || subdivisionDepth > 8) {
+
+		MGlobal::displayInfo("Error creating bpg: -sd (-subdivision depth) must be between 1 and 8");
+		return MS::kFailure;
+	}
+
+	int threads = argData.isFlagSet("-t") ? argData.flagArgumentInt("-t", 0) : 0;
+	if (threads < 0) {
+
+		MGlobal::displayInfo("Error creating bpg: -t (-threads) must be 0 (use all hardware threads) or greater");
+		return MS::kFailure;
+	}
+
+	bool sparse = argData.isFlagSet("-sp");
+	bool lazy = argData.isFlagSet("-lz");
+
 	if (GridManager::getInstance().gridCount() == 0) {
 
 		MSelectionList sel;
 		MGlobal::getActiveSelectionList(sel);
-		GridManager::getInstance().newGrid(xSize, ySize, zSize, unitSize, base, shadeRange, halfConeAngle, intensity);
+		GridManager::getInstance().newGrid(xSize, ySize, zSize, unitSize, base, shadeRange, halfConeAngle, intensity, subdivisionDepth,
+			static_cast<unsigned int>(threads), sparse);
+
+		MStatus status;
+		std::shared_ptr<BlockPointGrid> grid = GridManager::getInstance().getGrid(0, status);
+		if (status == MS::kSuccess)
+			grid->setLazyLightConditions(lazy);
+
 		MGlobal::setActiveSelectionList(sel);
 	}
 	else {
@@ -123,6 +147,18 @@ MSyntax CreateBlockPointGrid::newSyntax() {
 	syntax.addFlag("-hca", "-half cone angle", MSyntax::kDouble);
 	syntax.addFlag("-i", "-intensity", MSyntax::kDouble);
 
+	// The maximum number of times units are divided into eighths when building the ShadeVector graph.  Higher is more accurate but slower
+	syntax.addFlag("-sd", "-subdivision depth", MSyntax::kLong);
+
+	// The number of threads used to build the ShadeVector graph.  0 (the default) uses one per hardware thread
+	syntax.addFlag("-t", "-threads", MSyntax::kLong);
+
+	// Only allocate units as block points and shade reach them.  Saves memory and startup time for large grids that are mostly empty
+	syntax.addFlag("-sp", "-sparse");
+
+	// Only evaluate units' light conditions once they are read, rather than every time shade is applied.  Speeds up interactive edits
+	syntax.addFlag("-lz", "-lazy");
+
 	syntax.enableEdit(false);
 	syntax.enableQuery(false);
 
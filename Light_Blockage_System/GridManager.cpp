@@ -1,11 +1,13 @@
 #include "GridManager.h"
 
-void GridManager::newGrid(double XSIZE, double YSIZE, double ZSIZE, double UNITSIZE, MPoint BASE, double DETECTIONRANGE, double CONERANGEANGLE, double INTENSITY) {
+void GridManager::newGrid(double XSIZE, double YSIZE, double ZSIZE, double UNITSIZE, MPoint BASE, double DETECTIONRANGE, double CONERANGEANGLE, double INTENSITY,
+	int SUBDIVISIONDEPTH, unsigned int THREADS, bool SPARSE) {
 
 	MSelectionList sel;
 	MGlobal::getActiveSelectionList(sel);
 
-	grids.push_back(std::make_shared<BlockPointGrid>(static_cast<int>(grids.size()), XSIZE, YSIZE, ZSIZE, UNITSIZE, BASE, DETECTIONRANGE, CONERANGEANGLE, INTENSITY));
+	grids.push_back(std::make_shared<BlockPointGrid>(static_cast<int>(grids.size()), XSIZE, YSIZE, ZSIZE, UNITSIZE, BASE, DETECTIONRANGE, CONERANGEANGLE, INTENSITY,
+		SUBDIVISIONDEPTH, THREADS, SPARSE));
 
 	MGlobal::setActiveSelectionList(sel);
 }
@@ -15,7 +17,7 @@ std::shared_ptr<BlockPointGrid> GridManager::getGrid(unsigned int index, MStatus
 	if (grids.size() == 0) {
 
 		MGlobal::displayInfo(MString() + "No existing grid.  Creating default grid");
-		newGrid(16., 24., 16., .5, MPoint(0., -2., 0.), 3., (MH::PI / 4.), .1);
+		newGrid(16., 24., 16., .5, MPoint(0., -2., 0.), 3., (MH::PI / 4.), .1, BlockPointGrid::SUBDIVISION_DEPTH_DEFAULT(), 0, false);
 	}
 
 	if (index >= grids.size()) {
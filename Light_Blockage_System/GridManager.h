@@ -47,7 +47,8 @@ public:
 		MGlobal::displayInfo("GridManager and grids destroyed");
 	}
 
-	void newGrid(double XSIZE, double YSIZE, double ZSIZE, double UNITSIZE, MPoint BASE, double DETECTIONRANGE, double CONERANGEANGLE, double INTENSITY);
+	void newGrid(double XSIZE, double YSIZE, double ZSIZE, double UNITSIZE, MPoint BASE, double DETECTIONRANGE, double CONERANGEANGLE, double INTENSITY, int SUBDIVISIONDEPTH,
+		unsigned int THREADS, bool SPARSE);
 
 	std::size_t gridCount() { return grids.size(); }
 
@@ -4,54 +4,49 @@
 
 #include "GridUnit.h"
 
-void GridUnit::applyShadeVector(SvRelay* relay) {
+void GridUnit::applyShadeVector(const SvRelay* relay, const ShadeVectorGraph& graph) {
 
-	// If this shade index is not an ASV for this unit, insert it.  Otherwise, add to its count and percentage
-	auto it = appliedShadeVectors.find(relay->sv);
-	if (it == appliedShadeVectors.end()) {
+	// If this shade index is not an ASV for this unit, insert it.  Otherwise, add to its percentage
+	double percentage = store->appliedShadeVectors(index).add(relay->sv, relay->cumulativePercentage);
 
-		it = appliedShadeVectors.emplace(relay->sv, relay->cumulativePercentage).first;
-	}
-	else {
-		it->second += relay->cumulativePercentage;
-	}
-
-	MVector vectorToAdd = relay->sv->shadeVector * relay->cumulativePercentage;
-	shadeVectorSum += vectorToAdd;
-	totalVolumeBlocked += vectorToAdd.length();
+	MVector vectorToAdd = graph.shadeVectors[relay->sv] * relay->cumulativePercentage;
+	store->shadeVectorSum(index) += vectorToAdd;
+	store->totalVolumeBlocked(index) += vectorToAdd.length();
 
-	if (it->second > 1.01)
-		MGlobal::displayError(MString() + "ShadeVector " + it->first->toUnit.toMString() + " is over 100% (" + it->second
-			+ ") at unit " + name);
+	if (percentage > 1.01)
+		MGlobal::displayError(MString() + "ShadeVector " + graph.toUnits[relay->sv].toMString() + " is over 100% (" + percentage
+			+ ") at unit " + getName());
 }
 
-MStatus GridUnit::unapplyShadeVector(SvRelay* relay) {
+MStatus GridUnit::unapplyShadeVector(const SvRelay* relay, const ShadeVectorGraph& graph) {
 
-	auto it = appliedShadeVectors.find(relay->sv);
-	if (it == appliedShadeVectors.end()) {
-		MGlobal::displayError(MString() + "Attempted to remove shade index " + relay->sv->toUnit.toMString() + " from grid unit " + name + " but it was not there");
+	AppliedShadeVectors::subtractResult result = store->appliedShadeVectors(index).subtract(relay->sv, relay->cumulativePercentage);
+
+	if (result == AppliedShadeVectors::notApplied) {
+		MGlobal::displayError(MString() + "Attempted to remove shade index " + graph.toUnits[relay->sv].toMString() + " from grid unit " + getName() + " but it was not there");
 		return MS::kFailure;
 	}
 
-	it->second -= relay->cumulativePercentage;
-	if (almostEqual(it->second, 0.)) {
-		//MGlobal::displayInfo(MString() + "Removing shade index " + it->first->toUnit.toMString() + " from unit " + unit.name);
-		appliedShadeVectors.erase(it);
-	}
-	else if (it->second < 0.) {
-		MGlobal::displayError(MString() + "Removed more paths than existed from applied shade index at grid unit " + name);
+	// The percentage has been taken out of the applied ShadeVectors either way, so the sums are kept in step with them before reporting it
+	MVector vectorToSubtract = graph.shadeVectors[relay->sv] * relay->cumulativePercentage;
+	store->shadeVectorSum(index) -= vectorToSubtract;
+	store->totalVolumeBlocked(index) -= vectorToSubtract.length();
+
+	if (result == AppliedShadeVectors::overdrawn) {
+		MGlobal::displayError(MString() + "Removed more paths than existed from applied shade index at grid unit " + getName());
 		return MS::kFailure;
 	}
 
-	MVector vectorToSubtract = relay->sv->shadeVector * relay->cumulativePercentage;
-	shadeVectorSum -= vectorToSubtract;
-	totalVolumeBlocked -= vectorToSubtract.length();
-
 	return MS::kSuccess;
 }
 
 void GridUnit::updateLightConditions(double intensity, double maxVolumeBlocked, const MVector& unblockedLightDirection) {
 
+	double totalVolumeBlocked = store->totalVolumeBlocked(index);
+	double& shadePercentage = store->shadePercentage(index);
+	const MVector& shadeVectorSum = store->shadeVectorSum(index);
+	MVector& lightDirection = store->lightDirection(index);
+
 	//MGlobal::displayInfo(MString() + "updating light direction for " + name);
 
 	// The directnessOfLight factor is a quick and dirty means of adjusting the rate at which shade percentage tapers off as units get farther from block points.
@@ -102,11 +97,17 @@ void GridUnit::updateLightConditions(double intensity, double maxVolumeBlocked,
 
 void GridUnit::makeUnitArrow(double unitSize, MObject& shadingGroup) {
 
+	GridUnitDisplay& display = store->display(index);
+	MObject& arrowTransformNode = display.arrowTransformNode;
+	MObject& arrowShapeNode = display.arrowShapeNode;
+	MString name = getName();
+
 	// Create the arrow mesh
+	const MVector& lightDirection = store->lightDirection(index);
 	MVector displayVect(lightDirection.x, lightDirection.y, lightDirection.z);
 	displayVect = displayVect.normal() * unitSize;
-	arrowTransformNode = SimpleShapes::makeSmallArrow(center, displayVect, name, displayVect.length() * .15);
-	currentMeshDirection = displayVect.normal();
+	arrowTransformNode = SimpleShapes::makeSmallArrow(getCenter(), displayVect, name, displayVect.length() * .15);
+	display.currentMeshDirection = displayVect.normal();
 
 	MStatus status;
 	MFnDagNode nodeFn;
@@ -134,7 +135,7 @@ void GridUnit::makeUnitArrow(double unitSize, MObject& shadingGroup) {
 	attrFn.setReadable(true);
 	arrowFn.addAttribute(densityAttr);
 
-	arrowDensityPlug = arrowFn.findPlug(densityAttr, true);
+	display.arrowDensityPlug = arrowFn.findPlug(densityAttr, true);
 
 	setArrowDensityPlug();
 
@@ -145,20 +146,25 @@ void GridUnit::makeUnitArrow(double unitSize, MObject& shadingGroup) {
 	attrFn.setReadable(true);
 	arrowFn.addAttribute(shadeAttr);
 
-	arrowShadePlug = arrowFn.findPlug(shadeAttr, true);
+	display.arrowShadePlug = arrowFn.findPlug(shadeAttr, true);
 
 	setArrowShadePlug();
 
 	// Get a handle to the visibility plug for the arrow mesh
 	MFnDagNode arrowDagNode(arrowTransformNode, &status);
-	arrowVisibilityPlug = arrowDagNode.findPlug("visibility", true, &status);
+	display.arrowVisibilityPlug = arrowDagNode.findPlug("visibility", true, &status);
 
 	SimpleShapes::setObjectMaterial(arrowShapeNode, shadingGroup);
 }
 
 MStatus GridUnit::makeUnitCube(double unitSize, MObject& shadingGroup) {
 
-	cubeTransformNode = SimpleShapes::makeCube(center, unitSize, name + "_box");
+	GridUnitDisplay& display = store->display(index);
+	MObject& cubeTransformNode = display.cubeTransformNode;
+	MObject& cubeShapeNode = display.cubeShapeNode;
+	MString name = getName();
+
+	cubeTransformNode = SimpleShapes::makeCube(getCenter(), unitSize, name + "_box");
 
 	MStatus status;
 	MFnDagNode nodeFn;
@@ -188,13 +194,13 @@ MStatus GridUnit::makeUnitCube(double unitSize, MObject& shadingGroup) {
 	attrFn.setReadable(true);
 	cubeFn.addAttribute(shadeAttr);
 
-	cubeShadePlug = cubeFn.findPlug(shadeAttr, true);
+	display.cubeShadePlug = cubeFn.findPlug(shadeAttr, true);
 
 	setCubeShadePlug();
 
 	// Get a handle to the visibility plug for the cube mesh
 	MFnDagNode cubeDagNode(cubeTransformNode, &status);
-	cubeVisibilityPlug = cubeDagNode.findPlug("visibility", true, &status);
+	display.cubeVisibilityPlug = cubeDagNode.findPlug("visibility", true, &status);
 
 	SimpleShapes::setObjectMaterial(cubeShapeNode, shadingGroup);
 
@@ -205,7 +211,11 @@ MStatus GridUnit::setUVsToTile(double transparencyTileMapTileSize, double maxSha
 
 	MStatus status;
 
-	MFnMesh fnCube(cubeShapeNode, &status);
+	const GridUnitDisplay* display = store->findDisplay(index);
+	if (!display)
+		return MS::kFailure;
+
+	MFnMesh fnCube(display->cubeShapeNode, &status);
 
 	MFloatArray uArray, vArray;
 	status = fnCube.getUVs(uArray, vArray);
@@ -213,7 +223,7 @@ MStatus GridUnit::setUVsToTile(double transparencyTileMapTileSize, double maxSha
 		MGlobal::displayError("Failed to retrieve UVs. " + status.errorString());
 	}
 
-	int shadePercentageAsInt = static_cast<int>((shadePercentage) * 100);
+	int shadePercentageAsInt = static_cast<int>((store->shadePercentage(index)) * 100);
 	// If shadePercentageAsInt is 0, then the uv tiles won't be calculated right, so just set it to 1 if it is.  It's probably better to just not display
 	// any shaded units below 1%, but it could be nice at times just to see how many units are reached.
 	shadePercentageAsInt = shadePercentageAsInt == 0 ? 1 : shadePercentageAsInt;
@@ -264,16 +274,19 @@ MStatus GridUnit::setUVsToTile(double transparencyTileMapTileSize, double maxSha
 
 MStatus GridUnit::updateArrowMesh() {
 
-	if (arrowTransformNode.isNull() || currentMeshDirection == lightDirection)
+	GridUnitDisplay* display = store->findDisplay(index);
+	const MVector& lightDirection = store->lightDirection(index);
+
+	if (!display || display->arrowTransformNode.isNull() || display->currentMeshDirection == lightDirection)
 		return MS::kSuccess;
 
 	MStatus status;
-	MQuaternion meshDirRotation(currentMeshDirection, lightDirection);
-	MFnTransform arrowFn(arrowTransformNode, &status);
+	MQuaternion meshDirRotation(display->currentMeshDirection, lightDirection);
+	MFnTransform arrowFn(display->arrowTransformNode, &status);
 	SimpleShapes::unlockRotates(arrowFn.name());
 	arrowFn.rotateBy(meshDirRotation, MSpace::kTransform);
 	SimpleShapes::lockRotates(arrowFn.name());
-	currentMeshDirection = lightDirection;
+	display->currentMeshDirection = lightDirection;
 
 	return MS::kSuccess;
 }
\ No newline at end of file
@@ -1,10 +1,12 @@
 /*
-	A GridUnit is the unit of the BlockPointGrid.  Each unit stores information representing the light conditions in its volume.
+	A GridUnit is the unit of the BlockPointGrid.  Each unit stores information representing the light conditions in its volume, which is kept
+	in the grid's GridUnitStore.
 */
 
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <unordered_map>
 
 #include <maya/MPlug.h>
@@ -15,109 +17,65 @@
 #include <maya/MFnMesh.h>
 #include <maya/MFnTransform.h>
 
+#include "AppliedShadeVectors.h"
+#include "GridUnitStore.h"
 #include "Point_Int.h"
 #include "MathHelper.h"
-#include "ShadeVector.h"
+#include "ShadeVectorGraph.h"
 #include "SimpleShapes.h"
 
+/*
+	A handle to one unit of a GridUnitStore.  It is only an index into the store, so it is cheap to make and to copy, and any number of handles
+	may refer to the same unit.
+*/
 class GridUnit {
 
-	MString name;
-
-	MPoint center = { 0.,0.,0. };
-
-	Point_Int gridIndex = { 0, 0, 0 };
-
-	double totalVolumeBlocked = 0.;
-
-	double shadePercentage = 0.;
-
-	// Unit vector representing the direction towards the most light
-	MVector lightDirection = MVector(0., 1., 0.);
-
-	// The sum of all shade vectors affecting this unit.  
-	MVector shadeVectorSum = MVector(0., 0., 0.);
-
-	// Key: the applied ShadeVector
-	// Note that the percentage is only used at the unit where propagation starts, otherwise the cumulative percentage ShadeVectors is used
-	std::unordered_map<ShadeVector*, double> appliedShadeVectors;
-
-	// The sum of all block points' densities within this unit.  This value can fall outside of the 0 - 1 range, however, when it is used
-	// to block other units it is always clamped between 0 - 1.
-	int densityIncludingExcess = 0;
-
-	// The density of the unit, capped at 1.
-	int effectiveDensity = 0;
-
-	bool blocked = false;
-
-	/*** Members for debugging ***/
-
-	// The current direction that this unit's arrow mesh points.  This only needs to match light direction when the mesh is displayed,
-	// so it is updated every time the mesh is rotated, not necessarily every time light direction changes
-	MVector currentMeshDirection = MVector(0., 1., 0.);
-
-	// Handle to the arrow mesh for the unit
-	MObject arrowTransformNode;
-	MObject arrowShapeNode;
-
-	// Handle to the cube mesh for the unit
-	MObject cubeTransformNode;
-	MObject cubeShapeNode;
-
-	// Plugs are used to access and modify channels of the unit's mesh which we will use to display the unit and its density and shade values
-	MPlug arrowDensityPlug;
-	MPlug arrowShadePlug;
-	MPlug arrowVisibilityPlug;
-	MPlug cubeShadePlug;
-	MPlug cubeVisibilityPlug;
+	GridUnitStore* store = nullptr;
 
+	std::uint32_t index = 0;
 
 public:
 
-	GridUnit(MString name, double cX, double cY, double cZ, Point_Int index) {
+	GridUnit(GridUnitStore& units, std::uint32_t i) : store(&units), index(i) {}
 
-		this->name = name;
-		center.x = cX;
-		center.y = cY;
-		center.z = cZ;
-		gridIndex = index;
-	}
+	std::uint32_t getLinearIndex() const { return index; }
 
-	Point_Int getGridIndex() const { return gridIndex; }
+	Point_Int getGridIndex() const { return store->gridIndex(index); }
 
 	// Set the x, y, z values to the index values of the resulting grid unit
 	void getIndexAtUnit(const Point_Int& toUnit, int& x, int& y, int& z) const {
 
-		Point_Int unit = gridIndex + toUnit;
+		Point_Int unit = getGridIndex() + toUnit;
 		x = unit.x, y = unit.y, z = unit.z;
 	}
 
-	MVector getLightDirection() const { return lightDirection; }
+	MString getName() const { return store->name(index); }
+
+	// The unit's light conditions, which are evaluated first if the grid left them stale
+	MVector getLightDirection() const { store->evaluateLightIfStale(index); return store->lightDirection(index); }
 
 	// Must only be used after blockpoints have been updated for all trees per time loop iteration or after post deformers
 	void updateLightConditions(double intensity, double maxBlockage, const MVector& unblockedLightDirection);
 
-	MPoint getCenter() const { return center; }
-	void setCenter(MPoint c) { center = c; }
+	MPoint getCenter() const { return store->center(index); }
 
-	double getTotalVolumeBlocked() const { return totalVolumeBlocked; }
+	double getTotalVolumeBlocked() const { return store->totalVolumeBlocked(index); }
 
-	double getShadePercentage() const { return shadePercentage; }
+	double getShadePercentage() const { store->evaluateLightIfStale(index); return store->shadePercentage(index); }
 
-	std::unordered_map<ShadeVector*, double>& getAppliedShadeVectors() { return appliedShadeVectors; }
+	AppliedShadeVectors& getAppliedShadeVectors() { return store->appliedShadeVectors(index); }
 
-	void applyShadeVector(SvRelay* relay);
-	MStatus unapplyShadeVector(SvRelay* relay);
+	void applyShadeVector(const SvRelay* relay, const ShadeVectorGraph& graph);
+	MStatus unapplyShadeVector(const SvRelay* relay, const ShadeVectorGraph& graph);
 
-	bool isBlocked() const { return blocked; }
-	void setBlocked(bool b) { blocked = b; }
+	bool isBlocked() const { return store->blocked(index) != 0; }
+	void setBlocked(bool b) { store->blocked(index) = b ? 1 : 0; }
 
-	void adjustDensityIncludingExcess(int adj) { densityIncludingExcess += adj; }
+	void adjustDensityIncludingExcess(int adj) { store->densityIncludingExcess(index) += adj; }
 	void checkDensity(MStatus& status) const {
 
-		if (densityIncludingExcess < 0) {
-			MGlobal::displayError(MString() + "Error: unit " + name + " has densityIncludingExcess less than 0: " + densityIncludingExcess);
+		if (store->densityIncludingExcess(index) < 0) {
+			MGlobal::displayError(MString() + "Error: unit " + getName() + " has densityIncludingExcess less than 0: " + store->densityIncludingExcess(index));
 			status = MS::kFailure;
 		}
 	}
@@ -125,57 +83,73 @@ public:
 	// Update the effectiveDensity and return the difference from the previous value
 	double updateDensity() {
 
-		int newEffectiveDensity = std::min(densityIncludingExcess, 1);
-		int densityChange = newEffectiveDensity - effectiveDensity;
-		effectiveDensity = newEffectiveDensity;
+		int newEffectiveDensity = std::min(store->densityIncludingExcess(index), 1);
+		int densityChange = newEffectiveDensity - store->effectiveDensity(index);
+		store->effectiveDensity(index) = newEffectiveDensity;
 
 		return densityChange;
 	}
 
-	MObject getCubeTransformNode() const { return cubeTransformNode; }
+	MObject getCubeTransformNode() const {
+
+		const GridUnitDisplay* display = store->findDisplay(index);
+		return display ? display->cubeTransformNode : MObject();
+	}
+
 	void setCubeVisibility(bool v) {
 
-		if (!cubeTransformNode.isNull())
-			cubeVisibilityPlug.setValue(v);
+		GridUnitDisplay* display = store->findDisplay(index);
+		if (display && !display->cubeTransformNode.isNull())
+			display->cubeVisibilityPlug.setValue(v);
 	}
 
 	void setCubeShadePlug() {
 
+		MPlug& cubeShadePlug = store->display(index).cubeShadePlug;
 		cubeShadePlug.setLocked(false);
-		cubeShadePlug.setValue(shadePercentage);
+		cubeShadePlug.setValue(store->shadePercentage(index));
 		cubeShadePlug.setLocked(true);
 	}
 
 	void setArrowDensityPlug() {
 
-		if (!arrowDensityPlug.isNull()) {
+		GridUnitDisplay* display = store->findDisplay(index);
+		if (display && !display->arrowDensityPlug.isNull()) {
 
-			arrowDensityPlug.setLocked(false);
-			arrowDensityPlug.setValue(std::min(densityIncludingExcess, 1));
-			arrowDensityPlug.setLocked(true);
+			display->arrowDensityPlug.setLocked(false);
+			display->arrowDensityPlug.setValue(std::min(store->densityIncludingExcess(index), 1));
+			display->arrowDensityPlug.setLocked(true);
 		}
 	}
 
 	void setArrowShadePlug() {
 
+		MPlug& arrowShadePlug = store->display(index).arrowShadePlug;
 		arrowShadePlug.setLocked(false);
-		arrowShadePlug.setValue(shadePercentage);
+		arrowShadePlug.setValue(store->shadePercentage(index));
 		arrowShadePlug.setLocked(true);
 	}
 
-	MObject getArrowTransformNode() const { return arrowTransformNode; }
+	MObject getArrowTransformNode() const {
+
+		const GridUnitDisplay* display = store->findDisplay(index);
+		return display ? display->arrowTransformNode : MObject();
+	}
+
 	void setArrowVisibility(bool v) {
 
-		if (!arrowTransformNode.isNull())
-			arrowVisibilityPlug.setValue(v);
+		GridUnitDisplay* display = store->findDisplay(index);
+		if (display && !display->arrowTransformNode.isNull())
+			display->arrowVisibilityPlug.setValue(v);
 	}
 
 	bool arrowMeshIsVisible() const {
 
-		if (!arrowVisibilityPlug.isNull()) {
+		const GridUnitDisplay* display = store->findDisplay(index);
+		if (display && !display->arrowVisibilityPlug.isNull()) {
 
 			bool visible;
-			arrowVisibilityPlug.getValue(visible);
+			display->arrowVisibilityPlug.getValue(visible);
 			return visible;
 		}
 		else
@@ -190,4 +164,4 @@ public:
 	MStatus makeUnitCube(double unitSize, MObject& shadingGroup);
 
 	MStatus setUVsToTile(double transparencyTileMapTileSize, double maxShade, double uvOffset) const;
-};
\ No newline at end of file
+};
@@ -0,0 +1,105 @@
+#include <string>
+
+#include "GridUnitStore.h"
+
+GridUnitStore::Brick::Brick(const Point_Int& ORIGIN) : origin(ORIGIN) {
+
+	for (auto& direction : lightDirection)
+		direction = MVector(0., 1., 0.);
+}
+
+void GridUnitStore::initialize(int id, int X, int Y, int Z, double UNITSIZE, const MPoint& FIRSTCENTER, bool SPARSE) {
+
+	gridId = id;
+	xElements = X;
+	yElements = Y;
+	zElements = Z;
+	unitSize = UNITSIZE;
+	firstCenter = FIRSTCENTER;
+
+	xBricks = (X + BRICK_SIZE - 1) / BRICK_SIZE;
+	yBricks = (Y + BRICK_SIZE - 1) / BRICK_SIZE;
+	zBricks = (Z + BRICK_SIZE - 1) / BRICK_SIZE;
+
+	brickSlots.assign(static_cast<std::size_t>(xBricks) * yBricks * zBricks, -1);
+	bricks.clear();
+	displays.clear();
+
+	if (SPARSE)
+		return;
+
+	bricks.reserve(brickSlots.size());
+	for (int x = 0; x < X; x += BRICK_SIZE) {
+		for (int y = 0; y < Y; y += BRICK_SIZE) {
+			for (int z = 0; z < Z; z += BRICK_SIZE)
+				linearIndex(x, y, z);
+		}
+	}
+}
+
+std::uint32_t GridUnitStore::linearIndex(int x, int y, int z) {
+
+	std::int32_t& slot = brickSlot(x, y, z);
+	if (slot < 0) {
+
+		slot = static_cast<std::int32_t>(bricks.size());
+		Point_Int origin((x / BRICK_SIZE) * BRICK_SIZE, (y / BRICK_SIZE) * BRICK_SIZE, (z / BRICK_SIZE) * BRICK_SIZE);
+		bricks.push_back(std::make_unique<Brick>(origin));
+	}
+
+	return (static_cast<std::uint32_t>(slot) * BRICK_UNITS) + localIndex(x, y, z);
+}
+
+void GridUnitStore::findCellCorners(int x, int y, int z, int dx, int dy, int dz, std::uint32_t (&corners)[8]) const {
+
+	// The Morton code of each position along one axis of a brick, before it is shifted into that axis' bits
+	static_assert(BRICK_SIZE == 8, "SPREAD must have an entry for every position along a brick");
+	static const std::uint32_t SPREAD[BRICK_SIZE] = { 0, 1, 8, 9, 64, 65, 72, 73 };
+
+	const int coords[3][2] = { { x, x + dx }, { y, y + dy }, { z, z + dz } };
+	int brickCoords[3][2];
+	std::uint32_t localBits[3][2];
+
+	for (int axis = 0; axis < 3; ++axis) {
+		for (int side = 0; side < 2; ++side) {
+
+			brickCoords[axis][side] = coords[axis][side] / BRICK_SIZE;
+			localBits[axis][side] = SPREAD[coords[axis][side] % BRICK_SIZE] << axis;
+		}
+	}
+
+	for (int c = 0; c < 8; ++c) {
+
+		int sx = c & 1;
+		int sy = (c >> 1) & 1;
+		int sz = (c >> 2) & 1;
+
+		std::int32_t slot = brickSlots[(((brickCoords[0][sx] * yBricks) + brickCoords[1][sy]) * zBricks) + brickCoords[2][sz]];
+		corners[c] = slot < 0 ? NO_UNIT : (static_cast<std::uint32_t>(slot) * BRICK_UNITS) + (localBits[0][sx] | localBits[1][sy] | localBits[2][sz]);
+	}
+}
+
+MPoint GridUnitStore::center(std::uint32_t i) const {
+
+	Point_Int index = gridIndex(i);
+	return center(index.x, index.y, index.z);
+}
+
+MString GridUnitStore::name(std::uint32_t i) const {
+
+	Point_Int index = gridIndex(i);
+	std::string unitName = "g_" + std::to_string(gridId) + "_unit_" + std::to_string(index.x) + "_" + std::to_string(index.y) + "_" + std::to_string(index.z);
+	return MString(unitName.c_str());
+}
+
+GridUnitDisplay* GridUnitStore::findDisplay(std::uint32_t i) {
+
+	auto it = displays.find(i);
+	return it == displays.end() ? nullptr : &it->second;
+}
+
+const GridUnitDisplay* GridUnitStore::findDisplay(std::uint32_t i) const {
+
+	auto it = displays.find(i);
+	return it == displays.end() ? nullptr : &it->second;
+}
@@ -0,0 +1,222 @@
+/*
+	GridUnitStore holds every unit of a BlockPointGrid, linearly indexed in fixed size bricks.  Within a brick, the fields that the simulation
+	reads and writes for every unit are kept in their own arrays, so propagation only touches the memory it needs.  Everything used to display
+	a unit lives in a sparse side table that only has entries for units that have been given meshes.
+
+	Bricks can be allocated up front, or only once a block point or shade first reaches them, so that memory scales with the occupied volume
+	of large, mostly empty grids.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <maya/MObject.h>
+#include <maya/MPlug.h>
+#include <maya/MPoint.h>
+#include <maya/MString.h>
+#include <maya/MVector.h>
+
+#include "AppliedShadeVectors.h"
+#include "Morton.h"
+#include "Point_Int.h"
+#include "ShadeVectorGraph.h"
+
+// The Maya handles of a unit that is displayed
+struct GridUnitDisplay {
+
+	// The current direction that this unit's arrow mesh points.  This only needs to match light direction when the mesh is displayed,
+	// so it is updated every time the mesh is rotated, not necessarily every time light direction changes
+	MVector currentMeshDirection = MVector(0., 1., 0.);
+
+	// Handle to the arrow mesh for the unit
+	MObject arrowTransformNode;
+	MObject arrowShapeNode;
+
+	// Handle to the cube mesh for the unit
+	MObject cubeTransformNode;
+	MObject cubeShapeNode;
+
+	// Plugs are used to access and modify channels of the unit's mesh which we will use to display the unit and its density and shade values
+	MPlug arrowDensityPlug;
+	MPlug arrowShadePlug;
+	MPlug arrowVisibilityPlug;
+	MPlug cubeShadePlug;
+	MPlug cubeVisibilityPlug;
+};
+
+class GridUnitStore {
+
+public:
+
+	// Units are allocated in cubic bricks of BRICK_SIZE units on a side
+	static const int BRICK_SIZE = 8;
+	static const int BRICK_UNITS = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+
+	// Returned by findLinearIndex for units whose brick has not been allocated
+	static const std::uint32_t NO_UNIT = 0xffffffff;
+
+private:
+
+	// The fields of every unit in one brick, each in its own array
+	struct Brick {
+
+		// Grid index of the brick's first unit
+		Point_Int origin;
+
+		// The sum of all block points' densities within the unit.  This value can fall outside of the 0 - 1 range, however, when it is used
+		// to block other units it is always clamped between 0 - 1.
+		int densityIncludingExcess[BRICK_UNITS] = {};
+
+		// The density of the unit, capped at 1.
+		int effectiveDensity[BRICK_UNITS] = {};
+
+		std::uint8_t blocked[BRICK_UNITS] = {};
+
+		double totalVolumeBlocked[BRICK_UNITS] = {};
+
+		double shadePercentage[BRICK_UNITS] = {};
+
+		// The sum of all shade vectors affecting the unit
+		MVector shadeVectorSum[BRICK_UNITS];
+
+		// Unit vector representing the direction towards the most light
+		MVector lightDirection[BRICK_UNITS];
+
+		// 1 while shadePercentage and lightDirection are out of date, when the grid evaluates them lazily
+		std::uint8_t lightStale[BRICK_UNITS] = {};
+
+		// Key: the index of the applied ShadeVector in the ShadeVectorGraph
+		// Note that the percentage is only used at the unit where propagation starts, otherwise the cumulative percentage ShadeVectors is used
+		AppliedShadeVectors appliedShadeVectors[BRICK_UNITS];
+
+		explicit Brick(const Point_Int& ORIGIN);
+	};
+
+	int gridId = -1;
+	int xElements = 0;
+	int yElements = 0;
+	int zElements = 0;
+	double unitSize = 1.;
+
+	// The center of the unit at index (0, 0, 0)
+	MPoint firstCenter = { 0.,0.,0. };
+
+	int xBricks = 0;
+	int yBricks = 0;
+	int zBricks = 0;
+
+	// The slot in bricks of each brick of the grid, ordered x, then y, then z, or -1 if the brick has not been allocated
+	std::vector<std::int32_t> brickSlots;
+
+	// Bricks never move once allocated, so references to their units stay valid as more bricks are added
+	std::vector<std::unique_ptr<Brick>> bricks;
+
+	std::unordered_map<std::uint32_t, GridUnitDisplay> displays;
+
+	// Evaluates the light conditions of a stale unit.  Empty unless the grid evaluates them lazily.
+	std::function<void(std::uint32_t)> staleLightEvaluator;
+
+	std::int32_t& brickSlot(int x, int y, int z) { return brickSlots[(((x / BRICK_SIZE) * yBricks) + (y / BRICK_SIZE)) * zBricks + (z / BRICK_SIZE)]; }
+	std::int32_t brickSlot(int x, int y, int z) const { return brickSlots[(((x / BRICK_SIZE) * yBricks) + (y / BRICK_SIZE)) * zBricks + (z / BRICK_SIZE)]; }
+
+	// Position of a unit within its brick, in Morton order so that neighboring units are mostly near each other in memory
+	static std::uint32_t localIndex(int x, int y, int z) {
+
+		return static_cast<std::uint32_t>(Morton::encode(x % BRICK_SIZE, y % BRICK_SIZE, z % BRICK_SIZE));
+	}
+
+	Brick& brick(std::uint32_t i) { return *bricks[i / BRICK_UNITS]; }
+	const Brick& brick(std::uint32_t i) const { return *bricks[i / BRICK_UNITS]; }
+
+public:
+
+	/*
+		Sizes the store for a grid of X by Y by Z units, all unblocked and unshaded.  If SPARSE is true, bricks are only allocated once one of
+		their units is written to, and units in bricks that haven't been allocated are fully lit.  Otherwise every brick is allocated now.
+	*/
+	void initialize(int id, int X, int Y, int Z, double UNITSIZE, const MPoint& FIRSTCENTER, bool SPARSE);
+
+	// The number of units that have been allocated
+	std::size_t size() const { return bricks.size() * BRICK_UNITS; }
+
+	std::size_t allocatedBrickCount() const { return bricks.size(); }
+
+	// Units are identified by their brick's slot and their Morton ordered position in the brick.  Allocates the unit's brick if it hasn't been.
+	std::uint32_t linearIndex(int x, int y, int z);
+
+	// Same as linearIndex, but returns NO_UNIT rather than allocating
+	std::uint32_t findLinearIndex(int x, int y, int z) const {
+
+		std::int32_t slot = brickSlot(x, y, z);
+		return slot < 0 ? NO_UNIT : (static_cast<std::uint32_t>(slot) * BRICK_UNITS) + localIndex(x, y, z);
+	}
+
+	/*
+		Finds the linear indices of the eight units from (x, y, z) to (x + dx, y + dy, z + dz), where each step is 0 or 1.  Corner c is the
+		one stepped along x if c & 1 is set, along y if c & 2 is, and along z if c & 4 is, and is NO_UNIT if its brick hasn't been allocated.
+		The corners usually share a brick, so this looks up each brick once rather than once per corner.
+	*/
+	void findCellCorners(int x, int y, int z, int dx, int dy, int dz, std::uint32_t (&corners)[8]) const;
+
+	Point_Int gridIndex(std::uint32_t i) const {
+
+		return brick(i).origin + Morton::decode(i % BRICK_UNITS);
+	}
+
+	// False for units whose brick hasn't been allocated
+	bool isBlocked(int x, int y, int z) const {
+
+		std::uint32_t i = findLinearIndex(x, y, z);
+		return i != NO_UNIT && brick(i).blocked[i % BRICK_UNITS] != 0;
+	}
+
+	/*** Fields of the unit with linear index i ***/
+
+	int& densityIncludingExcess(std::uint32_t i) { return brick(i).densityIncludingExcess[i % BRICK_UNITS]; }
+	int& effectiveDensity(std::uint32_t i) { return brick(i).effectiveDensity[i % BRICK_UNITS]; }
+	std::uint8_t& blocked(std::uint32_t i) { return brick(i).blocked[i % BRICK_UNITS]; }
+	double& totalVolumeBlocked(std::uint32_t i) { return brick(i).totalVolumeBlocked[i % BRICK_UNITS]; }
+	double& shadePercentage(std::uint32_t i) { return brick(i).shadePercentage[i % BRICK_UNITS]; }
+	MVector& shadeVectorSum(std::uint32_t i) { return brick(i).shadeVectorSum[i % BRICK_UNITS]; }
+	MVector& lightDirection(std::uint32_t i) { return brick(i).lightDirection[i % BRICK_UNITS]; }
+	std::uint8_t& lightStale(std::uint32_t i) { return brick(i).lightStale[i % BRICK_UNITS]; }
+	AppliedShadeVectors& appliedShadeVectors(std::uint32_t i) { return brick(i).appliedShadeVectors[i % BRICK_UNITS]; }
+
+	double shadePercentage(std::uint32_t i) const { return brick(i).shadePercentage[i % BRICK_UNITS]; }
+	const MVector& lightDirection(std::uint32_t i) const { return brick(i).lightDirection[i % BRICK_UNITS]; }
+	bool isLightStale(std::uint32_t i) const { return brick(i).lightStale[i % BRICK_UNITS] != 0; }
+
+	// Sets what evaluates a unit's stale light conditions when they are read through a GridUnit.  Set by the grid that owns the store.
+	void setStaleLightEvaluator(std::function<void(std::uint32_t)> evaluator) { staleLightEvaluator = std::move(evaluator); }
+
+	// Evaluates the unit's light conditions first if they are stale, so that reading them never sees values from before the last applyShade
+	void evaluateLightIfStale(std::uint32_t i) {
+
+		if (isLightStale(i) && staleLightEvaluator)
+			staleLightEvaluator(i);
+	}
+
+	// The center of the unit at a grid index, whether or not it has been allocated
+	MPoint center(int x, int y, int z) const {
+
+		return MPoint(firstCenter.x + (x * unitSize), firstCenter.y + (y * unitSize), firstCenter.z + (z * unitSize));
+	}
+
+	MPoint center(std::uint32_t i) const;
+
+	// Names are only needed for meshes and messages, so they are made when asked for rather than stored
+	MString name(std::uint32_t i) const;
+
+	// Returns the unit's display handles, adding empty ones if it has none
+	GridUnitDisplay& display(std::uint32_t i) { return displays[i]; }
+
+	// Returns the unit's display handles, or nullptr if it has none
+	GridUnitDisplay* findDisplay(std::uint32_t i);
+	const GridUnitDisplay* findDisplay(std::uint32_t i) const;
+};
@@ -0,0 +1,294 @@
+#include <cmath>
+
+#include "LightFieldKernel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LIGHT_FIELD_KERNEL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LIGHT_FIELD_KERNEL_SSE2
+#endif
+
+namespace {
+
+	// Light directions blended to a squared length below this have cancelled out
+	const double MIN_DIRECTION_LENGTH_SQUARED = 1e-24;
+
+	// The thresholds GridUnit::updateLightConditions uses for no volume blocked, for no blockage, and for a rotation with no one axis
+	const double MIN_VOLUME_BLOCKED = 1e-8;
+	const double MIN_SHADE_VECTOR_SUM_LENGTH = .0001;
+	const double MIN_ROTATION_AXIS_LENGTH = 1e-12;
+
+	const double HALF_PI = 1.57079632679489661923;
+
+	/*
+		The operations the kernels need on a register of doubles.  Each kernel is written once against these, and each instruction set supplies
+		its own.  Scalar is the one used for the values left over after the last whole register, or for all of them without SIMD.  A Mask holds
+		the result of a comparison for each lane.
+	*/
+	struct ScalarLanes {
+
+		typedef double Value;
+		typedef bool Mask;
+		static const std::size_t WIDTH = 1;
+
+		static Value load(const double* p) { return *p; }
+		static void store(double* p, Value v) { *p = v; }
+		static Value set(double d) { return d; }
+		static Value add(Value a, Value b) { return a + b; }
+		static Value sub(Value a, Value b) { return a - b; }
+		static Value mul(Value a, Value b) { return a * b; }
+		static Value div(Value a, Value b) { return a / b; }
+		static Value sqrt(Value a) { return std::sqrt(a); }
+		static Value min(Value a, Value b) { return a < b ? a : b; }
+		static Value max(Value a, Value b) { return a > b ? a : b; }
+		static Value abs(Value a) { return std::abs(a); }
+
+		static Mask less(Value a, Value b) { return a < b; }
+		static Mask both(Mask a, Mask b) { return a && b; }
+
+		// Lanes set in a but not in b
+		static Mask andNot(Mask a, Mask b) { return a && !b; }
+
+		// Each lane of a where mask is set, otherwise of b
+		static Value select(Mask mask, Value a, Value b) { return mask ? a : b; }
+
+		// Bit k is set if lane k of mask is
+		static int bits(Mask mask) { return mask ? 1 : 0; }
+	};
+
+#if defined(LIGHT_FIELD_KERNEL_AVX2)
+
+	struct SimdLanes {
+
+		typedef __m256d Value;
+		typedef __m256d Mask;
+		static const std::size_t WIDTH = 4;
+
+		static Value load(const double* p) { return _mm256_loadu_pd(p); }
+		static void store(double* p, Value v) { _mm256_storeu_pd(p, v); }
+		static Value set(double d) { return _mm256_set1_pd(d); }
+		static Value add(Value a, Value b) { return _mm256_add_pd(a, b); }
+		static Value sub(Value a, Value b) { return _mm256_sub_pd(a, b); }
+		static Value mul(Value a, Value b) { return _mm256_mul_pd(a, b); }
+		static Value div(Value a, Value b) { return _mm256_div_pd(a, b); }
+		static Value sqrt(Value a) { return _mm256_sqrt_pd(a); }
+		static Value min(Value a, Value b) { return _mm256_min_pd(a, b); }
+		static Value max(Value a, Value b) { return _mm256_max_pd(a, b); }
+		static Value abs(Value a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.), a); }
+
+		static Mask less(Value a, Value b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+		static Mask both(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+		static Mask andNot(Mask a, Mask b) { return _mm256_andnot_pd(b, a); }
+		static Value select(Mask mask, Value a, Value b) { return _mm256_blendv_pd(b, a, mask); }
+		static int bits(Mask mask) { return _mm256_movemask_pd(mask); }
+	};
+
+#elif defined(LIGHT_FIELD_KERNEL_SSE2)
+
+	struct SimdLanes {
+
+		typedef __m128d Value;
+		typedef __m128d Mask;
+		static const std::size_t WIDTH = 2;
+
+		static Value load(const double* p) { return _mm_loadu_pd(p); }
+		static void store(double* p, Value v) { _mm_storeu_pd(p, v); }
+		static Value set(double d) { return _mm_set1_pd(d); }
+		static Value add(Value a, Value b) { return _mm_add_pd(a, b); }
+		static Value sub(Value a, Value b) { return _mm_sub_pd(a, b); }
+		static Value mul(Value a, Value b) { return _mm_mul_pd(a, b); }
+		static Value div(Value a, Value b) { return _mm_div_pd(a, b); }
+		static Value sqrt(Value a) { return _mm_sqrt_pd(a); }
+		static Value min(Value a, Value b) { return _mm_min_pd(a, b); }
+		static Value max(Value a, Value b) { return _mm_max_pd(a, b); }
+		static Value abs(Value a) { return _mm_andnot_pd(_mm_set1_pd(-0.), a); }
+
+		static Mask less(Value a, Value b) { return _mm_cmplt_pd(a, b); }
+		static Mask both(Mask a, Mask b) { return _mm_and_pd(a, b); }
+		static Mask andNot(Mask a, Mask b) { return _mm_andnot_pd(b, a); }
+		static Value select(Mask mask, Value a, Value b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+		static int bits(Mask mask) { return _mm_movemask_pd(mask); }
+	};
+
+#endif
+
+	// Blends one field of the eight corners of the points starting at i
+	template <typename Lanes>
+	typename Lanes::Value trilinear(const double (&field)[8][LightCorners::BLOCK_SIZE], std::size_t i, typename Lanes::Value fx, typename Lanes::Value fy,
+		typename Lanes::Value fz) {
+
+		typedef typename Lanes::Value Value;
+		auto lerp = [](Value a, Value b, Value t) { return Lanes::add(a, Lanes::mul(Lanes::sub(b, a), t)); };
+
+		Value y0z0 = lerp(Lanes::load(&field[0][i]), Lanes::load(&field[1][i]), fx);
+		Value y1z0 = lerp(Lanes::load(&field[2][i]), Lanes::load(&field[3][i]), fx);
+		Value y0z1 = lerp(Lanes::load(&field[4][i]), Lanes::load(&field[5][i]), fx);
+		Value y1z1 = lerp(Lanes::load(&field[6][i]), Lanes::load(&field[7][i]), fx);
+
+		return lerp(lerp(y0z0, y1z0, fy), lerp(y0z1, y1z1, fy), fz);
+	}
+
+	// Blends the points from begin until fewer than a register's worth are left, and returns the first point not blended
+	template <typename Lanes>
+	std::size_t blend(const LightCorners& corners, std::size_t begin, std::size_t count, const double fallbackDirection[3], double* shade, double* x,
+		double* y, double* z) {
+
+		typedef typename Lanes::Value Value;
+
+		const Value minLength = Lanes::set(MIN_DIRECTION_LENGTH_SQUARED);
+		const Value fallback[3] = { Lanes::set(fallbackDirection[0]), Lanes::set(fallbackDirection[1]), Lanes::set(fallbackDirection[2]) };
+		double* const out[3] = { x, y, z };
+
+		std::size_t i = begin;
+		for (; i + Lanes::WIDTH <= count; i += Lanes::WIDTH) {
+
+			Value fx = Lanes::load(&corners.fraction[0][i]);
+			Value fy = Lanes::load(&corners.fraction[1][i]);
+			Value fz = Lanes::load(&corners.fraction[2][i]);
+
+			Lanes::store(shade + i, trilinear<Lanes>(corners.shade, i, fx, fy, fz));
+
+			Value d[3];
+			for (int axis = 0; axis < 3; ++axis)
+				d[axis] = trilinear<Lanes>(corners.direction[axis], i, fx, fy, fz);
+
+			Value lengthSquared = Lanes::add(Lanes::add(Lanes::mul(d[0], d[0]), Lanes::mul(d[1], d[1])), Lanes::mul(d[2], d[2]));
+
+			// Lanes that fall back still divide, by 1 rather than a length of 0
+			typename Lanes::Mask cancelled = Lanes::less(lengthSquared, minLength);
+			Value length = Lanes::sqrt(Lanes::select(cancelled, Lanes::set(1.), lengthSquared));
+
+			for (int axis = 0; axis < 3; ++axis)
+				Lanes::store(out[axis] + i, Lanes::select(cancelled, fallback[axis], Lanes::div(d[axis], length)));
+		}
+
+		return i;
+	}
+
+	// Sine and cosine of angles from -pi / 2 to pi / 2, from their Taylor series, which are accurate to rounding over that range
+	template <typename Lanes>
+	void sinCos(typename Lanes::Value a, typename Lanes::Value& sin, typename Lanes::Value& cos) {
+
+		typedef typename Lanes::Value Value;
+
+		const int TERMS = 11;
+		Value a2 = Lanes::mul(a, a);
+		Value sinSeries = Lanes::set(1.);
+		Value cosSeries = Lanes::set(1.);
+
+		// Horner's rule from the last term: sin a = a (1 - a^2 / (2 * 3) (1 - a^2 / (4 * 5) (...))), and likewise for cos with (1 * 2), (3 * 4), ...
+		for (int n = TERMS; n >= 1; --n) {
+
+			sinSeries = Lanes::sub(Lanes::set(1.), Lanes::mul(Lanes::mul(a2, Lanes::set(1. / ((2. * n) * (2. * n + 1.)))), sinSeries));
+			cosSeries = Lanes::sub(Lanes::set(1.), Lanes::mul(Lanes::mul(a2, Lanes::set(1. / ((2. * n - 1.) * (2. * n)))), cosSeries));
+		}
+
+		sin = Lanes::mul(a, sinSeries);
+		cos = cosSeries;
+	}
+
+	// Evaluates the units of a block from begin until fewer than a register's worth are left, and returns the first unit not evaluated
+	template <typename Lanes>
+	std::size_t evaluate(LightConditionBlock& block, std::size_t begin, std::size_t count, double intensity, double maxVolumeBlocked,
+		const double unblockedDirection[3]) {
+
+		typedef typename Lanes::Value Value;
+		typedef typename Lanes::Mask Mask;
+
+		const Value zero = Lanes::set(0.);
+		const Value one = Lanes::set(1.);
+		const Value u[3] = { Lanes::set(unblockedDirection[0]), Lanes::set(unblockedDirection[1]), Lanes::set(unblockedDirection[2]) };
+
+		std::size_t i = begin;
+		for (; i + Lanes::WIDTH <= count; i += Lanes::WIDTH) {
+
+			Value volumeBlocked = Lanes::load(&block.totalVolumeBlocked[i]);
+			Value percentVolumeBlocked = Lanes::div(volumeBlocked, Lanes::set(maxVolumeBlocked));
+			Lanes::store(&block.shadePercentage[i], Lanes::select(Lanes::less(Lanes::abs(volumeBlocked), Lanes::set(MIN_VOLUME_BLOCKED)), zero, percentVolumeBlocked));
+
+			Value sum[3] = { Lanes::load(&block.shadeVectorSum[0][i]), Lanes::load(&block.shadeVectorSum[1][i]), Lanes::load(&block.shadeVectorSum[2][i]) };
+			Value length = Lanes::sqrt(Lanes::add(Lanes::add(Lanes::mul(sum[0], sum[0]), Lanes::mul(sum[1], sum[1])), Lanes::mul(sum[2], sum[2])));
+			Mask unblocked = Lanes::less(length, Lanes::set(MIN_SHADE_VECTOR_SUM_LENGTH));
+			length = Lanes::select(unblocked, one, length);
+
+			// b is the direction of the blockage, and cosine is the cosine of the angle between it and the unblocked direction
+			Value b[3] = { Lanes::div(sum[0], length), Lanes::div(sum[1], length), Lanes::div(sum[2], length) };
+			Value cosine = Lanes::add(Lanes::add(Lanes::mul(u[0], b[0]), Lanes::mul(u[1], b[1])), Lanes::mul(u[2], b[2]));
+			cosine = Lanes::max(Lanes::set(-1.), Lanes::min(one, cosine));
+			Value sine = Lanes::sqrt(Lanes::max(zero, Lanes::sub(one, Lanes::mul(cosine, cosine))));
+
+			// Only blockage more than 90 degrees from the unblocked direction turns the light.  When it is straight against it, the caller decides
+			// which way.
+			Mask turns = Lanes::andNot(Lanes::less(cosine, zero), unblocked);
+			Mask unresolved = Lanes::both(turns, Lanes::less(sine, Lanes::set(MIN_ROTATION_AXIS_LENGTH)));
+			turns = Lanes::andNot(turns, unresolved);
+
+			/*
+				The light turns from the unblocked direction toward the blockage by intensity * percentVolumeBlocked, but no further than 90 degrees
+				from the blockage, which is an angle whose sine is -cosine and whose cosine is sine.  Turning by an angle t within the plane of u and
+				b is Rodrigues' rotation with the axis perpendicular to both: u cos t + w sin t, where w is the unit vector along b - (u . b) u.
+			*/
+			Value turn = Lanes::max(Lanes::set(-HALF_PI), Lanes::min(Lanes::set(HALF_PI), Lanes::mul(Lanes::set(intensity), percentVolumeBlocked)));
+			Value turnSin;
+			Value turnCos;
+			sinCos<Lanes>(turn, turnSin, turnCos);
+
+			Value toBlockage = Lanes::sub(zero, cosine);
+			Mask limited = Lanes::less(toBlockage, turnSin);
+			turnSin = Lanes::select(limited, toBlockage, turnSin);
+			turnCos = Lanes::select(limited, sine, turnCos);
+
+			Value wScale = Lanes::div(turnSin, Lanes::select(turns, sine, one));
+
+			for (int axis = 0; axis < 3; ++axis) {
+
+				Value w = Lanes::sub(b[axis], Lanes::mul(cosine, u[axis]));
+				Value turned = Lanes::add(Lanes::mul(u[axis], turnCos), Lanes::mul(w, wScale));
+				Value previous = Lanes::load(&block.lightDirection[axis][i]);
+
+				Lanes::store(&block.lightDirection[axis][i], Lanes::select(unblocked, u[axis], Lanes::select(turns, turned, previous)));
+			}
+
+			int unresolvedBits = Lanes::bits(unresolved);
+			for (std::size_t k = 0; k < Lanes::WIDTH; ++k)
+				block.unresolved[i + k] = static_cast<std::uint8_t>((unresolvedBits >> k) & 1);
+		}
+
+		return i;
+	}
+}
+
+void blendLightCorners(const LightCorners& corners, std::size_t count, const double fallbackDirection[3], double* shade, double* x, double* y, double* z) {
+
+	std::size_t i = 0;
+
+#if defined(LIGHT_FIELD_KERNEL_AVX2) || defined(LIGHT_FIELD_KERNEL_SSE2)
+	i = blend<SimdLanes>(corners, i, count, fallbackDirection, shade, x, y, z);
+#endif
+
+	blend<ScalarLanes>(corners, i, count, fallbackDirection, shade, x, y, z);
+}
+
+void evaluateLightConditions(LightConditionBlock& block, std::size_t count, double intensity, double maxVolumeBlocked, const double unblockedDirection[3]) {
+
+	std::size_t i = 0;
+
+#if defined(LIGHT_FIELD_KERNEL_AVX2) || defined(LIGHT_FIELD_KERNEL_SSE2)
+	i = evaluate<SimdLanes>(block, i, count, intensity, maxVolumeBlocked, unblockedDirection);
+#endif
+
+	evaluate<ScalarLanes>(block, i, count, intensity, maxVolumeBlocked, unblockedDirection);
+}
+
+const char* lightFieldKernelInstructionSet() {
+
+#if defined(LIGHT_FIELD_KERNEL_AVX2)
+	return "AVX2";
+#elif defined(LIGHT_FIELD_KERNEL_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+	The light conditions at the eight unit centers around each of a block of query points, and where each point lies between them.  Points
+	are stored in separate arrays per field, so the blend can work on several points at once.
+
+	Corner c is the unit one step further along x than the first corner if c & 1 is set, along y if c & 2 is, and along z if c & 4 is.
+*/
+struct LightCorners {
+
+	static const std::size_t BLOCK_SIZE = 64;
+
+	// How far each point is from its first corner toward the last along x, y, and z, from 0 to 1
+	double fraction[3][BLOCK_SIZE];
+
+	double shade[8][BLOCK_SIZE];
+
+	// The x, y, and z of each corner's light direction
+	double direction[3][8][BLOCK_SIZE];
+};
+
+/*
+	Trilinearly blends the corners of the first count points of a block, writing each point's shade, and its light direction normalized, to
+	shade[i] and x[i], y[i], z[i].  Where the corners' directions cancel out, the light direction is fallbackDirection.
+
+	Uses AVX2 or SSE2 when the compiler targets them, and plain scalar code otherwise.
+*/
+void blendLightCorners(const LightCorners& corners, std::size_t count, const double fallbackDirection[3], double* shade, double* x, double* y, double* z);
+
+// The fields GridUnit::updateLightConditions reads and writes for a block of units, one array per field, so several units can be evaluated at once
+struct LightConditionBlock {
+
+	static const std::size_t BLOCK_SIZE = 64;
+
+	double totalVolumeBlocked[BLOCK_SIZE];
+
+	// The x, y, and z of each unit's shade vector sum
+	double shadeVectorSum[3][BLOCK_SIZE];
+
+	// The x, y, and z of each unit's light direction.  Units whose blockage doesn't turn the light keep the direction they had.
+	double lightDirection[3][BLOCK_SIZE];
+
+	// Written by evaluateLightConditions
+	double shadePercentage[BLOCK_SIZE];
+
+	// Set to 1 for units whose blockage is straight against the unblocked direction.  Every axis perpendicular to the two turns one toward
+	// the other, so these units' light directions are left for the caller to find the way updateLightConditions does.
+	std::uint8_t unresolved[BLOCK_SIZE];
+};
+
+/*
+	Evaluates the shade percentage and light direction of the first count units of a block, as GridUnit::updateLightConditions does for one.
+	Rather than measuring the angle between the unblocked direction and the blockage with acos and rotating by a quaternion, the light is
+	turned in closed form within the plane of the two, which only takes square roots and short polynomials.  unblockedDirection must be
+	normalized.
+
+	Uses AVX2 or SSE2 when the compiler targets them, and plain scalar code otherwise.
+*/
+void evaluateLightConditions(LightConditionBlock& block, std::size_t count, double intensity, double maxVolumeBlocked, const double unblockedDirection[3]);
+
+// The name of the instruction set blendLightCorners and evaluateLightConditions were compiled for
+const char* lightFieldKernelInstructionSet();
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/*
+	A read-only memory mapping of a whole file.  The mapping is released when the object is destroyed, so any pointers
+	obtained from data() must not outlive it.
+*/
+class MappedFile {
+
+	const unsigned char* mappedData = nullptr;
+	std::size_t mappedSize = 0;
+
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#else
+	int fileDescriptor = -1;
+#endif
+
+public:
+
+	MappedFile() {}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile() { close(); }
+
+	// Maps the file at path.  Returns false if the file does not exist, is empty, or cannot be mapped
+	bool open(const std::string& path);
+
+	void close();
+
+	bool isOpen() const { return mappedData != nullptr; }
+
+	const unsigned char* data() const { return mappedData; }
+
+	std::size_t size() const { return mappedSize; }
+};
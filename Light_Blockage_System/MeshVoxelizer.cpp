@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cmath>
+
+#include "MeshVoxelizer.h"
+#include "ParallelFor.h"
+
+namespace {
+
+	struct Vec3 {
+
+		double x;
+		double y;
+		double z;
+
+		Vec3 operator-(const Vec3& rhs) const { return { x - rhs.x, y - rhs.y, z - rhs.z }; }
+		double operator[](int axis) const { return axis == 0 ? x : (axis == 1 ? y : z); }
+	};
+
+	Vec3 cross(const Vec3& a, const Vec3& b) { return { (a.y * b.z) - (a.z * b.y), (a.z * b.x) - (a.x * b.z), (a.x * b.y) - (a.y * b.x) }; }
+	double dot(const Vec3& a, const Vec3& b) { return (a.x * b.x) + (a.y * b.y) + (a.z * b.z); }
+
+	// A triangle in grid index space, where the center of the unit at index (x, y, z) is the point (x, y, z)
+	struct Triangle {
+
+		Vec3 v[3];
+		Vec3 min;
+		Vec3 max;
+	};
+
+	// Separating axis test between a triangle and the cube of half size .5 around center
+	bool triangleTouchesUnit(const Triangle& t, const Vec3& center) {
+
+		const double h = .5;
+		Vec3 v[3] = { t.v[0] - center, t.v[1] - center, t.v[2] - center };
+
+		// The cube's faces
+		for (int axis = 0; axis < 3; ++axis) {
+
+			if (std::min({ v[0][axis], v[1][axis], v[2][axis] }) > h || std::max({ v[0][axis], v[1][axis], v[2][axis] }) < -h)
+				return false;
+		}
+
+		// The triangle's plane
+		Vec3 e[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+		Vec3 normal = cross(e[0], e[1]);
+		double normalReach = h * (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+		if (std::abs(dot(normal, v[0])) > normalReach)
+			return false;
+
+		// Cross products of the triangle's edges with the cube's axes
+		const Vec3 unitAxes[3] = { { 1., 0., 0. }, { 0., 1., 0. }, { 0., 0., 1. } };
+		for (const Vec3& edge : e) {
+			for (const Vec3& unitAxis : unitAxes) {
+
+				Vec3 axis = cross(unitAxis, edge);
+				double p0 = dot(axis, v[0]);
+				double p1 = dot(axis, v[1]);
+				double p2 = dot(axis, v[2]);
+				double reach = h * (std::abs(axis.x) + std::abs(axis.y) + std::abs(axis.z));
+
+				if (std::min({ p0, p1, p2 }) > reach || std::max({ p0, p1, p2 }) < -reach)
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	/*
+		Whether (px, py) is inside the triangle's projection onto the xy plane, and if so, the z of the triangle there.  Points on an edge count
+		for only one of the two triangles sharing it, by the top-left rule, so a closed mesh is crossed an even number of times.
+	*/
+	bool projectedCrossing(const Triangle& t, double px, double py, double& z) {
+
+		const Vec3* a = &t.v[0];
+		const Vec3* b = &t.v[1];
+		const Vec3* c = &t.v[2];
+
+		double area = ((b->x - a->x) * (c->y - a->y)) - ((b->y - a->y) * (c->x - a->x));
+		if (area == 0.)
+			return false;
+
+		// Wind counter-clockwise
+		if (area < 0.) {
+
+			std::swap(b, c);
+			area = -area;
+		}
+
+		auto edgeWeight = [px, py](const Vec3& from, const Vec3& to, double& weight) {
+
+			double dx = to.x - from.x;
+			double dy = to.y - from.y;
+			weight = (dx * (py - from.y)) - (dy * (px - from.x));
+
+			bool topLeft = (dy < 0.) || (dy == 0. && dx < 0.);
+			return weight > 0. || (weight == 0. && topLeft);
+		};
+
+		double wa = 0.;
+		double wb = 0.;
+		double wc = 0.;
+		if (!edgeWeight(*b, *c, wa) || !edgeWeight(*c, *a, wb) || !edgeWeight(*a, *b, wc))
+			return false;
+
+		z = ((wa * a->z) + (wb * b->z) + (wc * c->z)) / area;
+		return true;
+	}
+
+	// Converts a whole number index along an axis of size units to int, first clamping it to one unit beyond either end of the axis so
+	// that far off or non-finite coordinates can't overflow
+	int clampedIndex(double i, int size) { return static_cast<int>(std::min(std::max(-1., i), static_cast<double>(size))); }
+}
+
+VoxelizedMesh MeshVoxelizer::voxelize(const std::vector<float>& vertices, const std::vector<std::uint32_t>& indices, const double firstCenter[3],
+	double unitSize, int X, int Y, int Z, bool solid, unsigned int threadCount) {
+
+	VoxelizedMesh mesh;
+	std::size_t triangleCount = indices.size() / 3;
+
+	if (triangleCount == 0)
+		return mesh;
+
+	std::vector<Triangle> triangles(triangleCount);
+	Vec3 meshMin = { HUGE_VAL, HUGE_VAL, HUGE_VAL };
+	Vec3 meshMax = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+
+	for (std::size_t t = 0; t < triangleCount; ++t) {
+
+		Triangle& triangle = triangles[t];
+		for (int corner = 0; corner < 3; ++corner) {
+
+			const float* p = &vertices[static_cast<std::size_t>(indices[(t * 3) + corner]) * 3];
+			triangle.v[corner] = { (p[0] - firstCenter[0]) / unitSize, (p[1] - firstCenter[1]) / unitSize, (p[2] - firstCenter[2]) / unitSize };
+		}
+
+		triangle.min = { std::min({ triangle.v[0].x, triangle.v[1].x, triangle.v[2].x }), std::min({ triangle.v[0].y, triangle.v[1].y, triangle.v[2].y }),
+			std::min({ triangle.v[0].z, triangle.v[1].z, triangle.v[2].z }) };
+		triangle.max = { std::max({ triangle.v[0].x, triangle.v[1].x, triangle.v[2].x }), std::max({ triangle.v[0].y, triangle.v[1].y, triangle.v[2].y }),
+			std::max({ triangle.v[0].z, triangle.v[1].z, triangle.v[2].z }) };
+
+		meshMin = { std::min(meshMin.x, triangle.min.x), std::min(meshMin.y, triangle.min.y), std::min(meshMin.z, triangle.min.z) };
+		meshMax = { std::max(meshMax.x, triangle.max.x), std::max(meshMax.y, triangle.max.y), std::max(meshMax.z, triangle.max.z) };
+	}
+
+	// The units whose cubes can touch [lo, hi] along an axis of size units
+	auto firstUnit = [](double lo, int size) { return clampedIndex(std::ceil(lo - .5), size); };
+	auto lastUnit = [](double hi, int size) { return clampedIndex(std::floor(hi + .5), size); };
+
+	mesh.xBegin = std::max(0, firstUnit(meshMin.x, X));
+	mesh.yBegin = std::max(0, firstUnit(meshMin.y, Y));
+	mesh.zBegin = std::max(0, firstUnit(meshMin.z, Z));
+	mesh.xSize = std::max(0, std::min(X - 1, lastUnit(meshMax.x, X)) - mesh.xBegin + 1);
+	mesh.ySize = std::max(0, std::min(Y - 1, lastUnit(meshMax.y, Y)) - mesh.yBegin + 1);
+	mesh.zSize = std::max(0, std::min(Z - 1, lastUnit(meshMax.z, Z)) - mesh.zBegin + 1);
+
+	if (mesh.xSize == 0 || mesh.ySize == 0 || mesh.zSize == 0)
+		return mesh;
+
+	mesh.occupied.assign(static_cast<std::size_t>(mesh.xSize) * mesh.ySize * mesh.zSize, 0);
+
+	// The triangles that reach each slab
+	std::size_t slabCount = static_cast<std::size_t>((mesh.xSize + SLAB_WIDTH - 1) / SLAB_WIDTH);
+	std::vector<std::vector<std::uint32_t>> slabTriangles(slabCount);
+
+	for (std::size_t t = 0; t < triangleCount; ++t) {
+
+		int first = std::max(0, firstUnit(triangles[t].min.x, X) - mesh.xBegin);
+		int last = std::min(mesh.xSize - 1, lastUnit(triangles[t].max.x, X) - mesh.xBegin);
+
+		for (int slab = first / SLAB_WIDTH; first <= last && slab <= last / SLAB_WIDTH; ++slab)
+			slabTriangles[slab].push_back(static_cast<std::uint32_t>(t));
+	}
+
+	auto unitIndex = [&mesh](int x, int y, int z) { return ((static_cast<std::size_t>(x) * mesh.ySize) + y) * mesh.zSize + z; };
+
+	parallelFor(slabCount, threadCount, [&](std::size_t slab) {
+
+		int slabBegin = static_cast<int>(slab) * SLAB_WIDTH;
+		int slabEnd = std::min(mesh.xSize, slabBegin + SLAB_WIDTH);
+
+		for (std::uint32_t t : slabTriangles[slab]) {
+
+			const Triangle& triangle = triangles[t];
+
+			int xFirst = std::max(slabBegin, firstUnit(triangle.min.x, X) - mesh.xBegin);
+			int xLast = std::min(slabEnd - 1, lastUnit(triangle.max.x, X) - mesh.xBegin);
+			int yFirst = std::max(0, firstUnit(triangle.min.y, Y) - mesh.yBegin);
+			int yLast = std::min(mesh.ySize - 1, lastUnit(triangle.max.y, Y) - mesh.yBegin);
+			int zFirst = std::max(0, firstUnit(triangle.min.z, Z) - mesh.zBegin);
+			int zLast = std::min(mesh.zSize - 1, lastUnit(triangle.max.z, Z) - mesh.zBegin);
+
+			for (int x = xFirst; x <= xLast; ++x) {
+				for (int y = yFirst; y <= yLast; ++y) {
+					for (int z = zFirst; z <= zLast; ++z) {
+
+						std::uint8_t& occupied = mesh.occupied[unitIndex(x, y, z)];
+						Vec3 center = { static_cast<double>(mesh.xBegin + x), static_cast<double>(mesh.yBegin + y), static_cast<double>(mesh.zBegin + z) };
+
+						if (!occupied && triangleTouchesUnit(triangle, center))
+							occupied = 1;
+					}
+				}
+			}
+		}
+
+		if (!solid)
+			return;
+
+		// Cast a ray along z through the center of each column of units in the slab.  Units whose centers are between an odd crossing of
+		// the mesh and the next one are inside it.
+		std::vector<std::vector<double>> crossings(static_cast<std::size_t>(slabEnd - slabBegin) * mesh.ySize);
+
+		for (std::uint32_t t : slabTriangles[slab]) {
+
+			const Triangle& triangle = triangles[t];
+
+			int xFirst = std::max(slabBegin, clampedIndex(std::ceil(triangle.min.x), X) - mesh.xBegin);
+			int xLast = std::min(slabEnd - 1, clampedIndex(std::floor(triangle.max.x), X) - mesh.xBegin);
+			int yFirst = std::max(0, clampedIndex(std::ceil(triangle.min.y), Y) - mesh.yBegin);
+			int yLast = std::min(mesh.ySize - 1, clampedIndex(std::floor(triangle.max.y), Y) - mesh.yBegin);
+
+			for (int x = xFirst; x <= xLast; ++x) {
+				for (int y = yFirst; y <= yLast; ++y) {
+
+					double z = 0.;
+					if (projectedCrossing(triangle, mesh.xBegin + x, mesh.yBegin + y, z) && !std::isnan(z))
+						crossings[(static_cast<std::size_t>(x - slabBegin) * mesh.ySize) + y].push_back(z - mesh.zBegin);
+				}
+			}
+		}
+
+		for (int x = slabBegin; x < slabEnd; ++x) {
+			for (int y = 0; y < mesh.ySize; ++y) {
+
+				std::vector<double>& column = crossings[(static_cast<std::size_t>(x - slabBegin) * mesh.ySize) + y];
+				std::sort(column.begin(), column.end());
+
+				// A column crossed an odd number of times passes through a hole in the mesh, and its last crossing is ignored
+				for (std::size_t c = 0; c + 1 < column.size(); c += 2) {
+
+					int zFirst = std::max(0, clampedIndex(std::ceil(column[c]), mesh.zSize));
+					int zLast = std::min(mesh.zSize - 1, clampedIndex(std::floor(column[c + 1]), mesh.zSize));
+
+					for (int z = zFirst; z <= zLast; ++z)
+						mesh.occupied[unitIndex(x, y, z)] = 1;
+				}
+			}
+		}
+	});
+
+	return mesh;
+}
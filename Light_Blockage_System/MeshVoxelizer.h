@@ -0,0 +1,67 @@
+/*
+	Voxelizes triangle meshes onto a grid of cubic units, so that static scene geometry can occlude light without being approximated by block
+	points.  Meshes are passed as plain vertex and index buffers, and nothing here depends on Maya.
+
+	The surface is voxelized conservatively: every unit whose cube a triangle touches is covered.  Closed meshes can also be filled, which
+	covers every unit whose center is inside the mesh.  Both split the mesh's box of units into slabs along x that are voxelized in parallel,
+	each by only the triangles that reach it, so no two threads ever write the same unit.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SlotMap.h"
+
+// The units of a grid a mesh covers, stored for the box of units around the mesh
+struct VoxelizedMesh {
+
+	// Grid index of the box's first unit, and the box's size in units
+	int xBegin = 0;
+	int yBegin = 0;
+	int zBegin = 0;
+	int xSize = 0;
+	int ySize = 0;
+	int zSize = 0;
+
+	// 1 for each covered unit of the box, ordered x, then y, then z
+	std::vector<std::uint8_t> occupied;
+
+	// Calls func(x, y, z) with the grid index of every covered unit
+	template <typename Func>
+	void forEachOccupied(Func func) const {
+
+		std::size_t i = 0;
+		for (int x = 0; x < xSize; ++x) {
+			for (int y = 0; y < ySize; ++y) {
+				for (int z = 0; z < zSize; ++z, ++i) {
+
+					if (occupied[i])
+						func(xBegin + x, yBegin + y, zBegin + z);
+				}
+			}
+		}
+	}
+};
+
+// Identifies a mesh added to a grid.  Handles stay valid until the mesh is deleted.
+typedef SlotMapHandle MeshHandle;
+
+class MeshVoxelizer {
+
+public:
+
+	// The width, in units, of the slabs that are voxelized in parallel
+	static const int SLAB_WIDTH = 4;
+
+	/*
+		vertices holds the x, y, and z of each vertex, and indices holds the three vertex indices of each triangle.  The grid has X by Y by Z
+		units of unitSize, and firstCenter is the center of its unit at index (0, 0, 0).  If solid is true, units whose centers are inside the
+		mesh are also covered, which requires the mesh to be closed.  Parts of the mesh off of the grid are ignored.  threadCount is the number
+		of threads to use, where 0 means one per hardware thread.
+	*/
+	static VoxelizedMesh voxelize(const std::vector<float>& vertices, const std::vector<std::uint32_t>& indices, const double firstCenter[3],
+		double unitSize, int X, int Y, int Z, bool solid, unsigned int threadCount);
+};
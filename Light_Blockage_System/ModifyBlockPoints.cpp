@@ -28,56 +28,190 @@ MStatus ModifyBlockPoints::doIt(const MArgList& argList) {
 		return MS::kSuccess;
 	}
 
+	if (argData.isFlagSet("-e") && argData.flagArgumentBool("-e", 0)) {
+
+		status = edit(argData);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		return MS::kSuccess;
+	}
+
+	if (argData.isFlagSet("-d") && argData.flagArgumentBool("-d", 0)) {
+
+		status = remove(argData);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		return MS::kSuccess;
+	}
+
 	return MS::kSuccess;
 }
 
-MStatus ModifyBlockPoints::create(const MArgDatabase& argData) {
+std::vector<MPoint> ModifyBlockPoints::getLocations(const MArgDatabase& argData) {
 
 	MStatus status;
 	std::vector<MPoint> locations;
 	MArgList coordArgs;
 	unsigned int coordCount = argData.numberOfFlagUses("-l");
 
-	if (coordCount > 0) {
+	for (unsigned int i = 0; i + 2 < coordCount; i += 3) {
 
-		for (unsigned int i = 0; i < coordCount; i += 3) {
+		argData.getFlagArgumentList("-l", i, coordArgs);
+		argData.getFlagArgumentList("-l", i + 1, coordArgs);
+		argData.getFlagArgumentList("-l", i + 2, coordArgs);
+		locations.push_back(MPoint(coordArgs.asDouble(i, &status), coordArgs.asDouble(i + 1, &status), coordArgs.asDouble(i + 2, &status)));
+	}
 
-			argData.getFlagArgumentList("-l", i, coordArgs);
-			argData.getFlagArgumentList("-l", i + 1, coordArgs);
-			argData.getFlagArgumentList("-l", i + 2, coordArgs);
-			locations.push_back(MPoint(coordArgs.asDouble(i, &status), coordArgs.asDouble(i + 1, &status), coordArgs.asDouble(i + 2, &status)));
-		}
+	return locations;
+}
+
+std::vector<BlockPointHandle> ModifyBlockPoints::getBlockPoints(const MArgDatabase& argData, BlockPointGrid& grid) {
+
+	MStatus status;
+	std::vector<BlockPointHandle> handles;
+	MArgList idArgs;
+	unsigned int idCount = argData.numberOfFlagUses("-id");
+
+	for (unsigned int i = 0; i < idCount; ++i) {
+
+		argData.getFlagArgumentList("-id", i, idArgs);
+		int bpId = idArgs.asInt(i, &status);
+		BlockPointHandle handle = grid.findBlockPoint(bpId);
+
+		if (!grid.hasBlockPoint(handle))
+			MGlobal::displayWarning(MString() + "There is no block point with id " + bpId);
+
+		handles.push_back(handle);
 	}
-	else
+
+	return handles;
+}
+
+MStatus ModifyBlockPoints::create(const MArgDatabase& argData) {
+
+	MStatus status;
+	std::shared_ptr<BlockPointGrid> grid = GridManager::getInstance().getGrid(0, status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+
+	std::vector<MPoint> locations = getLocations(argData);
+	if (locations.empty())
 		locations.push_back(MPoint(0., 0., 0.));
 
 	double density = argData.flagArgumentDouble("-den", 0);
 	double radius = argData.flagArgumentDouble("-rad", 0);
 
-	std::vector<std::shared_ptr<BlockPoint>> newBPs;
+	// Locations off the grid get stale handles, and have already been reported
+	std::vector<BlockPointHandle> handles;
+	grid->addBlockPoints(locations, { density }, { radius }, handles);
 
-	for (auto& l : locations) {
+	std::vector<BlockPointHandle> newBPs;
+	MIntArray newIds;
 
-		std::shared_ptr<BlockPoint> bp = nullptr;
-		GridManager::getInstance().getGrid(0, status)->addBlockPoint(l, density, radius, bp);
-		newBPs.push_back(bp);
-		bp->setCurrentUnit(GridManager::getInstance().getGrid(0, status)->pointToIndex(l));
-		bp->setGrid(GridManager::getInstance().getGrid(0, status).get());
+	for (std::size_t i = 0; i < handles.size(); ++i) {
+
+		BlockPoint* bp = grid->getBlockPoint(handles[i]);
+		if (!bp)
+			continue;
+
+		bp->setCurrentUnit(grid->pointToIndex(locations[i]));
+		newBPs.push_back(handles[i]);
+		newIds.append(bp->getId());
 	}
 
 	MSelectionList originalSelection;
 	MGlobal::getActiveSelectionList(originalSelection);
 
-	GridManager::getInstance().getGrid(0, status)->startAuxTimer();
-	status = GridManager::getInstance().getGrid(0, status)->applyShade();
+	grid->startAuxTimer();
+	status = grid->applyShade();
 	CHECK_MSTATUS_AND_RETURN_IT(status);
-	double applyShadeTime = GridManager::getInstance().getGrid(0, status)->getTime();
+	double applyShadeTime = grid->getTime();
 	MGlobal::displayInfo(MString() + "Apply shade time: " + applyShadeTime);
-	GridManager::getInstance().getGrid(0, status)->displayBlockPoints(newBPs);
-	GridManager::getInstance().getGrid(0, status)->attachBPCallbacks(newBPs);
+	grid->displayBlockPoints(newBPs);
+	grid->attachBPCallbacks(newBPs);
 
 	MGlobal::setActiveSelectionList(originalSelection);
 
+	// The ids are how later edits and deletes refer to these block points
+	setResult(newIds);
+
+	return MS::kSuccess;
+}
+
+MStatus ModifyBlockPoints::edit(const MArgDatabase& argData) {
+
+	MStatus status;
+	std::shared_ptr<BlockPointGrid> grid = GridManager::getInstance().getGrid(0, status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+
+	std::vector<BlockPointHandle> handles = getBlockPoints(argData, *grid);
+	std::vector<MPoint> locations = getLocations(argData);
+
+	if (handles.size() != locations.size()) {
+
+		MGlobal::displayError(MString() + "Expected a location for each of the " + static_cast<unsigned int>(handles.size()) + " ids");
+		return MS::kInvalidParameter;
+	}
+
+	grid->moveBlockPoints(handles, locations);
+
+	MSelectionList originalSelection;
+	MGlobal::getActiveSelectionList(originalSelection);
+
+	grid->startAuxTimer();
+	status = grid->applyShade();
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	double applyShadeTime = grid->getTime();
+	MGlobal::displayInfo(MString() + "Apply shade time: " + applyShadeTime);
+
+	// Block points that were moved have their meshes moved to match.  Their current units are updated first, so that the attribute
+	// changed callbacks see that the grid is already up to date.
+	for (std::size_t i = 0; i < handles.size(); ++i) {
+
+		BlockPoint* bp = grid->getBlockPoint(handles[i]);
+		if (!bp || bp->getLoc() != locations[i])
+			continue;
+
+		bp->setCurrentUnit(grid->pointToIndex(locations[i]));
+
+		MObject transformNode = bp->getTransformNode();
+		if (!transformNode.isNull()) {
+
+			MFnTransform bpTransformFn(transformNode);
+			bpTransformFn.setTranslation(MVector(locations[i]), MSpace::kTransform);
+		}
+	}
+
+	MGlobal::setActiveSelectionList(originalSelection);
+
+	return MS::kSuccess;
+}
+
+MStatus ModifyBlockPoints::remove(const MArgDatabase& argData) {
+
+	MStatus status;
+	std::shared_ptr<BlockPointGrid> grid = GridManager::getInstance().getGrid(0, status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+
+	std::vector<BlockPointHandle> handles = getBlockPoints(argData, *grid);
+
+	// The meshes are deleted after the block points, so their removal callbacks find that there is nothing left to do
+	std::vector<MObject> transformNodes;
+	for (const auto& handle : handles) {
+
+		BlockPoint* bp = grid->getBlockPoint(handle);
+		if (bp && !bp->getTransformNode().isNull())
+			transformNodes.push_back(bp->getTransformNode());
+	}
+
+	grid->deleteBlockPoints(handles);
+
+	grid->startAuxTimer();
+	status = grid->applyShade();
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	double applyShadeTime = grid->getTime();
+	MGlobal::displayInfo(MString() + "Apply shade time: " + applyShadeTime);
+
+	for (auto& node : transformNodes)
+		MGlobal::deleteNode(node);
+
 	return MS::kSuccess;
 }
 
@@ -92,6 +226,8 @@ MSyntax ModifyBlockPoints::newSyntax() {
 	syntax.makeFlagMultiUse("-l");
 	syntax.addFlag("-den", "-density", MSyntax::kDouble);
 	syntax.addFlag("-rad", "-radius", MSyntax::kDouble);
+	syntax.addFlag("-id", "-ids", MSyntax::kLong);
+	syntax.makeFlagMultiUse("-id");
 
 	syntax.enableEdit(false);
 	syntax.enableQuery(false);
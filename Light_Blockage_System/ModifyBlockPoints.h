@@ -4,6 +4,8 @@
 #include <maya/MSyntax.h>
 #include <maya/MArgDatabase.h>
 #include <maya/MArgList.h>
+#include <maya/MFnTransform.h>
+#include <maya/MIntArray.h>
 
 #include "BlockPointGrid.h"
 #include "GridManager.h"
@@ -18,5 +20,20 @@ public:
 
 	static MSyntax newSyntax();
 
+	// Adds a block point at each location passed with -l, and returns their ids
 	static MStatus create(const MArgDatabase& argData);
+
+	// Moves the block points with the ids passed with -id to the locations passed with -l, one location per id
+	static MStatus edit(const MArgDatabase& argData);
+
+	// Deletes the block points with the ids passed with -id, along with their meshes
+	static MStatus remove(const MArgDatabase& argData);
+
+private:
+
+	// The points passed with -l, as x, y, z triples
+	static std::vector<MPoint> getLocations(const MArgDatabase& argData);
+
+	// Handles to the block points with the ids passed with -id.  Ids with no block point get stale handles.
+	static std::vector<BlockPointHandle> getBlockPoints(const MArgDatabase& argData, BlockPointGrid& grid);
 };
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include <maya/MItSelectionList.h>
+#include <maya/MDagPath.h>
+#include <maya/MFnMesh.h>
+#include <maya/MFloatPointArray.h>
+
+#include "ModifyOccluders.h"
+#include "GridManager.h"
+#include "BlockPointGrid.h"
+
+MStatus ModifyOccluders::doIt(const MArgList& argList) {
+
+	MStatus status;
+	MArgDatabase argData(syntax(), argList, &status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+
+	if (GridManager::getInstance().gridCount() < 1) {
+
+		MGlobal::displayInfo("There is no grid");
+		return MS::kSuccess;
+	}
+
+	if (argData.isFlagSet("-c") && argData.flagArgumentBool("-c", 0)) {
+
+		status = create(argData);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		return MS::kSuccess;
+	}
+
+	if (argData.isFlagSet("-d") && argData.flagArgumentBool("-d", 0)) {
+
+		status = remove(argData);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		return MS::kSuccess;
+	}
+
+	return MS::kSuccess;
+}
+
+MStatus ModifyOccluders::create(const MArgDatabase& argData) {
+
+	MStatus status;
+	std::shared_ptr<BlockPointGrid> grid = GridManager::getInstance().getGrid(0, status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+
+	if (argData.isFlagSet("-pc"))
+		status = createPointCloud(argData, *grid);
+	else if (argData.isFlagSet("-m") && argData.flagArgumentBool("-m", 0))
+		status = createMeshes(argData, *grid);
+	else {
+
+		MGlobal::displayError("Pass a point cloud file with -pc, or select meshes and pass -m true");
+		return MS::kInvalidParameter;
+	}
+
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+
+	grid->startAuxTimer();
+	status = grid->applyShade();
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	double applyShadeTime = grid->getTime();
+	MGlobal::displayInfo(MString() + "Apply shade time: " + applyShadeTime);
+
+	return MS::kSuccess;
+}
+
+MStatus ModifyOccluders::createPointCloud(const MArgDatabase& argData, BlockPointGrid& grid) {
+
+	MStatus status;
+	MString path = argData.flagArgumentString("-pc", 0);
+	bool hasRadius = argData.isFlagSet("-hr") && argData.flagArgumentBool("-hr", 0);
+	double density = argData.isFlagSet("-den") ? argData.flagArgumentDouble("-den", 0) : 1.;
+
+	PointCloudHandle handle;
+	grid.startAuxTimer();
+	status = grid.addPointCloud(path.asChar(), hasRadius, density, handle);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	MGlobal::displayInfo(MString() + "Point cloud load time: " + grid.getTime());
+
+	// The id is how a later delete refers to the point cloud
+	setResult(grid.getPointCloudId(handle));
+
+	return MS::kSuccess;
+}
+
+MStatus ModifyOccluders::createMeshes(const MArgDatabase& argData, BlockPointGrid& grid) {
+
+	MStatus status;
+	bool solid = argData.isFlagSet("-s") && argData.flagArgumentBool("-s", 0);
+	double density = argData.isFlagSet("-den") ? argData.flagArgumentDouble("-den", 0) : 1.;
+
+	MSelectionList selectionList;
+	MGlobal::getActiveSelectionList(selectionList);
+	MIntArray newIds;
+
+	grid.startAuxTimer();
+	for (MItSelectionList it(selectionList); !it.isDone(); it.next()) {
+
+		MDagPath dagPath;
+		if (it.getDagPath(dagPath) != MS::kSuccess || dagPath.extendToShape() != MS::kSuccess || !dagPath.hasFn(MFn::kMesh))
+			continue;
+
+		MFnMesh meshFn(dagPath, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+
+		MFloatPointArray points;
+		status = meshFn.getPoints(points, MSpace::kWorld);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+
+		// Maya triangulates each face, and triangleVertices holds the vertex indices of every triangle in turn
+		MIntArray triangleCounts;
+		MIntArray triangleVertices;
+		status = meshFn.getTriangles(triangleCounts, triangleVertices);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+
+		std::vector<float> vertices;
+		vertices.reserve(points.length() * 3);
+		for (unsigned int i = 0; i < points.length(); ++i) {
+
+			vertices.push_back(points[i].x);
+			vertices.push_back(points[i].y);
+			vertices.push_back(points[i].z);
+		}
+
+		std::vector<std::uint32_t> indices;
+		indices.reserve(triangleVertices.length());
+		for (unsigned int i = 0; i < triangleVertices.length(); ++i)
+			indices.push_back(static_cast<std::uint32_t>(triangleVertices[i]));
+
+		MeshHandle handle;
+		status = grid.addMesh(vertices, indices, density, solid, handle);
+		if (status != MS::kSuccess) {
+
+			MGlobal::displayWarning(MString() + "Skipped mesh " + dagPath.partialPathName());
+			continue;
+		}
+
+		newIds.append(grid.getMeshId(handle));
+	}
+
+	MGlobal::displayInfo(MString() + "Voxelized " + newIds.length() + " meshes in " + grid.getTime());
+
+	// The ids are how later deletes refer to these meshes
+	setResult(newIds);
+
+	return MS::kSuccess;
+}
+
+MStatus ModifyOccluders::remove(const MArgDatabase& argData) {
+
+	MStatus status;
+	std::shared_ptr<BlockPointGrid> grid = GridManager::getInstance().getGrid(0, status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+
+	MArgList idArgs;
+	unsigned int idCount = argData.numberOfFlagUses("-id");
+
+	for (unsigned int i = 0; i < idCount; ++i) {
+
+		argData.getFlagArgumentList("-id", i, idArgs);
+		int id = idArgs.asInt(i, &status);
+		PointCloudHandle pointCloud = grid->findPointCloud(id);
+		MeshHandle mesh = grid->findMesh(id);
+
+		if (grid->hasPointCloud(pointCloud))
+			grid->deletePointCloud(pointCloud);
+		else if (grid->hasMesh(mesh))
+			grid->deleteMesh(mesh);
+		else
+			MGlobal::displayWarning(MString() + "There is no occluder with id " + id);
+	}
+
+	grid->startAuxTimer();
+	status = grid->applyShade();
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	double applyShadeTime = grid->getTime();
+	MGlobal::displayInfo(MString() + "Apply shade time: " + applyShadeTime);
+
+	return MS::kSuccess;
+}
+
+MSyntax ModifyOccluders::newSyntax() {
+
+	MSyntax syntax;
+
+	syntax.addFlag("-c", "-create", MSyntax::kBoolean);
+	syntax.addFlag("-d", "-delete", MSyntax::kBoolean);
+	syntax.addFlag("-pc", "-pointCloud", MSyntax::kString);
+	syntax.addFlag("-hr", "-hasRadius", MSyntax::kBoolean);
+	syntax.addFlag("-m", "-mesh", MSyntax::kBoolean);
+	syntax.addFlag("-s", "-solid", MSyntax::kBoolean);
+	syntax.addFlag("-den", "-density", MSyntax::kDouble);
+	syntax.addFlag("-id", "-ids", MSyntax::kLong);
+	syntax.makeFlagMultiUse("-id");
+
+	syntax.enableEdit(false);
+	syntax.enableQuery(false);
+
+	return syntax;
+}
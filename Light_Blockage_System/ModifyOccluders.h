@@ -0,0 +1,42 @@
+#pragma once
+
+#include <maya/MPxCommand.h>
+#include <maya/MSyntax.h>
+#include <maya/MArgDatabase.h>
+#include <maya/MArgList.h>
+#include <maya/MIntArray.h>
+
+#include "BlockPointGrid.h"
+#include "GridManager.h"
+
+/*
+	Adds and deletes the occluders that aren't block points.  Each is given an id when it is added, which is the command's result, and is
+	deleted by passing that id with -id.
+
+	modifyOccluders -c true -pc "C:/clouds/canopy.bin" -hr true -den 1;
+	modifyOccluders -c true -m true -s true -den 1;
+	modifyOccluders -d true -id 0;
+*/
+class ModifyOccluders : public MPxCommand
+{
+public:
+
+	virtual MStatus doIt(const MArgList& argList);
+
+	static void* creator() { return new ModifyOccluders; }
+
+	static MSyntax newSyntax();
+
+	// Adds the point cloud passed with -pc, or if -m is true, the selected meshes
+	static MStatus create(const MArgDatabase& argData);
+
+	// Loads the point cloud file passed with -pc, whose points have radii if -hr is true, and returns its id
+	static MStatus createPointCloud(const MArgDatabase& argData, BlockPointGrid& grid);
+
+	// Voxelizes each selected mesh in world space, filling its inside as well if -s is true, and returns their ids in the order they were
+	// selected.  Selected objects that aren't meshes are skipped.
+	static MStatus createMeshes(const MArgDatabase& argData, BlockPointGrid& grid);
+
+	// Deletes the occluders with the ids passed with -id
+	static MStatus remove(const MArgDatabase& argData);
+};
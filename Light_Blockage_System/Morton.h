@@ -0,0 +1,49 @@
+/*
+	Morton (Z-order) codes for grid indices.  The bits of x, y, and z are interleaved, so units that are close together in the grid tend to be
+	close together in the order of their codes.  Each coordinate may use up to 21 bits and must not be negative.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "Point_Int.h"
+
+namespace Morton {
+
+	// Spreads the low 21 bits of v out so that there are two zero bits between each of them
+	inline std::uint64_t spread(std::uint64_t v) {
+
+		v &= 0x1fffff;
+		v = (v | (v << 32)) & 0x1f00000000ffffULL;
+		v = (v | (v << 16)) & 0x1f0000ff0000ffULL;
+		v = (v | (v << 8)) & 0x100f00f00f00f00fULL;
+		v = (v | (v << 4)) & 0x10c30c30c30c30c3ULL;
+		v = (v | (v << 2)) & 0x1249249249249249ULL;
+		return v;
+	}
+
+	// The inverse of spread
+	inline std::uint64_t compact(std::uint64_t v) {
+
+		v &= 0x1249249249249249ULL;
+		v = (v ^ (v >> 2)) & 0x10c30c30c30c30c3ULL;
+		v = (v ^ (v >> 4)) & 0x100f00f00f00f00fULL;
+		v = (v ^ (v >> 8)) & 0x1f0000ff0000ffULL;
+		v = (v ^ (v >> 16)) & 0x1f00000000ffffULL;
+		v = (v ^ (v >> 32)) & 0x1fffff;
+		return v;
+	}
+
+	inline std::uint64_t encode(int x, int y, int z) {
+
+		return spread(static_cast<std::uint64_t>(x)) | (spread(static_cast<std::uint64_t>(y)) << 1) | (spread(static_cast<std::uint64_t>(z)) << 2);
+	}
+
+	inline std::uint64_t encode(const Point_Int& p) { return encode(p.x, p.y, p.z); }
+
+	inline Point_Int decode(std::uint64_t code) {
+
+		return Point_Int(static_cast<int>(compact(code)), static_cast<int>(compact(code >> 1)), static_cast<int>(compact(code >> 2)));
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Returns the number of worker threads to use when threadCount threads are requested.  0 means one per hardware thread.
+inline unsigned int resolveThreadCount(unsigned int threadCount) {
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	return threadCount;
+}
+
+/*
+	Calls func(i) for every i in [0, count), spread over up to threadCount threads (0 uses every hardware thread).
+	Indices are handed out in chunks of chunkSize from a shared counter, so a thread that finishes its chunk early
+	simply takes the next one and uneven amounts of work per index balance out.  The calling thread takes part in the work,
+	and the call returns once every index has been processed.
+	func must be safe to call concurrently for different indices.
+*/
+template <typename Func>
+void parallelFor(std::size_t count, unsigned int threadCount, Func func, std::size_t chunkSize = 1) {
+
+	if (count == 0)
+		return;
+
+	chunkSize = std::max<std::size_t>(chunkSize, 1);
+	std::size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+	unsigned int workerCount = static_cast<unsigned int>(std::min<std::size_t>(resolveThreadCount(threadCount), chunkCount));
+
+	if (workerCount <= 1) {
+
+		for (std::size_t i = 0; i < count; ++i)
+			func(i);
+
+		return;
+	}
+
+	std::atomic<std::size_t> nextChunk(0);
+	auto work = [&]() {
+
+		for (std::size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+
+			std::size_t end = std::min(count, (chunk + 1) * chunkSize);
+			for (std::size_t i = chunk * chunkSize; i < end; ++i)
+				func(i);
+		}
+	};
+
+	std::vector<std::thread> workers;
+	workers.reserve(workerCount - 1);
+	for (unsigned int t = 1; t < workerCount; ++t)
+		workers.emplace_back(work);
+
+	work();
+
+	for (auto& worker : workers)
+		worker.join();
+}
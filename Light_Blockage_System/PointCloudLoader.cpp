@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <tuple>
+
+#include "PointCloudLoader.h"
+#include "CoverageStencil.h"
+#include "MappedFile.h"
+#include "ParallelFor.h"
+
+namespace {
+
+	// A point's unit, then what its coverage rounds to
+	typedef std::tuple<int, int, int, int, int, int, int> CoverageKey;
+
+	CoverageKey coverageKey(const BinnedPoint& point) {
+
+		return CoverageKey(point.x, point.y, point.z, point.radiusStep, point.subUnitStep[0], point.subUnitStep[1], point.subUnitStep[2]);
+	}
+
+	bool sameCoverage(const BinnedPoint& lhs, const BinnedPoint& rhs) { return coverageKey(lhs) == coverageKey(rhs); }
+
+	// Sorts points by unit, then coverage, and keeps only the first point in the file of each coverage in each unit
+	void mergeCoverages(std::vector<BinnedPoint>& points) {
+
+		std::sort(points.begin(), points.end(), [](const BinnedPoint& lhs, const BinnedPoint& rhs) {
+
+			return sameCoverage(lhs, rhs) ? lhs.pointIndex < rhs.pointIndex : coverageKey(lhs) < coverageKey(rhs);
+		});
+
+		points.erase(std::unique(points.begin(), points.end(), sameCoverage), points.end());
+	}
+}
+
+bool PointCloudLoader::load(const std::string& path, bool hasRadius, const double firstCenter[3], double unitSize, int X, int Y, int Z,
+	unsigned int threadCount, std::vector<BinnedPoint>& points, std::string& error) {
+
+	points.clear();
+
+	MappedFile file;
+	if (!file.open(path)) {
+
+		error = "Could not open point cloud " + path;
+		return false;
+	}
+
+	const std::size_t stride = (hasRadius ? 4 : 3) * sizeof(float);
+	if (file.size() % stride != 0) {
+
+		error = "Point cloud " + path + " is " + std::to_string(file.size()) + " bytes, which is not a whole number of " + std::to_string(stride) + " byte points";
+		return false;
+	}
+
+	const std::size_t pointCount = file.size() / stride;
+	const std::size_t chunkCount = (pointCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	std::vector<std::vector<BinnedPoint>> chunkPoints(chunkCount);
+
+	parallelFor(chunkCount, threadCount, [&](std::size_t c) {
+
+		std::vector<BinnedPoint>& binned = chunkPoints[c];
+		std::size_t end = std::min(pointCount, (c + 1) * CHUNK_SIZE);
+
+		for (std::size_t i = c * CHUNK_SIZE; i < end; ++i) {
+
+			// The mapping is only byte aligned as far as we know, so points are copied out rather than read in place
+			float values[4] = { 0.f, 0.f, 0.f, 0.f };
+			std::memcpy(values, file.data() + (i * stride), stride);
+
+			if (!std::isfinite(values[0]) || !std::isfinite(values[1]) || !std::isfinite(values[2]) || !std::isfinite(values[3]))
+				continue;
+
+			// Grid index space, where the center of the unit at index (x, y, z) is the point (x, y, z)
+			double px = (values[0] - firstCenter[0]) / unitSize;
+			double py = (values[1] - firstCenter[1]) / unitSize;
+			double pz = (values[2] - firstCenter[2]) / unitSize;
+
+			// Checked before converting to int, so that points far off of the grid can't overflow
+			double ux = std::floor(px + .5);
+			double uy = std::floor(py + .5);
+			double uz = std::floor(pz + .5);
+
+			if (ux < 0. || ux >= X || uy < 0. || uy >= Y || uz < 0. || uz >= Z)
+				continue;
+
+			BinnedPoint point;
+			point.x = static_cast<int>(ux);
+			point.y = static_cast<int>(uy);
+			point.z = static_cast<int>(uz);
+
+			point.radius = std::max(values[3], 0.f);
+			point.subUnitOffset[0] = static_cast<float>(px - point.x);
+			point.subUnitOffset[1] = static_cast<float>(py - point.y);
+			point.subUnitOffset[2] = static_cast<float>(pz - point.z);
+			point.pointIndex = i;
+
+			// Points without radii only cover their unit, wherever they are in it
+			if (hasRadius) {
+
+				point.radiusStep = CoverageStencil::radiusStep(std::min(point.radius / unitSize, CoverageStencil::maxUsefulRadius(X, Y, Z)));
+				for (int axis = 0; axis < 3; ++axis)
+					point.subUnitStep[axis] = CoverageStencil::subUnitStep(point.subUnitOffset[axis]);
+			}
+
+			binned.push_back(point);
+		}
+
+		mergeCoverages(binned);
+	});
+
+	if (chunkCount == 1) {
+
+		points = std::move(chunkPoints[0]);
+		return true;
+	}
+
+	std::size_t binnedCount = 0;
+	for (const auto& chunk : chunkPoints)
+		binnedCount += chunk.size();
+
+	points.reserve(binnedCount);
+	for (const auto& chunk : chunkPoints)
+		points.insert(points.end(), chunk.begin(), chunk.end());
+
+	// Coverages with points in more than one chunk appear once for each
+	mergeCoverages(points);
+
+	return true;
+}
@@ -0,0 +1,60 @@
+/*
+	Loads scanned point clouds, such as LiDAR scans of real canopies, so they can be used as occluders.
+
+	A point cloud file is nothing but packed points, with no header.  Each point is three 32-bit floats x, y, z, optionally followed by a
+	fourth float radius, all little-endian.  The file is memory mapped and its points are binned into the units of a grid in parallel chunks.
+	Points that would cover the same units are merged, so that however dense the scan, each unit is only handled once for each distinct
+	coverage.  Without radii that is every point in a unit.  With radii it is every point in a unit whose radius and position within the unit
+	round to the same CoverageStencil.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SlotMap.h"
+
+// The points of a cloud that fell in one unit and round to the same coverage, merged
+struct BinnedPoint {
+
+	// Grid index of the unit
+	int x = 0;
+	int y = 0;
+	int z = 0;
+
+	// The radius, and the position within the unit in unit sizes from its center, of the first of the merged points in the file
+	float radius = 0.f;
+	float subUnitOffset[3] = { 0.f, 0.f, 0.f };
+
+	// What the merged points round to, as CoverageStencil::radiusStep and CoverageStencil::subUnitStep.  All 0 for points without radii.
+	int radiusStep = 0;
+	int subUnitStep[3] = { 0, 0, 0 };
+
+	// Position in the file of the point that radius and subUnitOffset came from
+	std::uint64_t pointIndex = 0;
+};
+
+// Identifies a point cloud added to a grid.  Handles stay valid until the point cloud is deleted.
+typedef SlotMapHandle PointCloudHandle;
+
+class PointCloudLoader {
+
+public:
+
+	// Points are binned in parallel in chunks of this many
+	static const std::size_t CHUNK_SIZE = 65536;
+
+	/*
+		Bins the points of the file at path into a grid of X by Y by Z units of unitSize, where firstCenter is the center of the unit at index
+		(0, 0, 0).  hasRadius says whether each point has a radius.  points is filled with one BinnedPoint for each unit that has points, or
+		with radii, for each distinct coverage in each unit, ordered by unit x, then y, then z.  Points off the grid, or that aren't finite, are skipped.  threadCount is the number of threads to use,
+		where 0 means one per hardware thread.
+
+		Returns false, with a description in error, if the file can't be mapped or its size isn't a whole number of points.
+	*/
+	static bool load(const std::string& path, bool hasRadius, const double firstCenter[3], double unitSize, int X, int Y, int Z,
+		unsigned int threadCount, std::vector<BinnedPoint>& points, std::string& error);
+};
@@ -0,0 +1,136 @@
+#include <cmath>
+
+#include "RayFaceKernel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RAY_FACE_KERNEL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RAY_FACE_KERNEL_SSE2
+#endif
+
+namespace {
+
+	// Minimum of (ray . normal)^2 / |ray|^2 for a ray to count as facing a side.  Matches a dot product of the normalized ray below -1e-6.
+	const double MIN_FACING_SQUARED = 1e-12;
+
+	// Handles the points that don't fill a whole vector register, or all of them without SIMD
+	void intersectRaysWithSidesScalar(const FacingSides& sides, const double* x, const double* y, const double* z, std::size_t begin, std::size_t end,
+		std::uint8_t* hits) {
+
+		for (std::size_t i = begin; i < end; ++i) {
+
+			const double p[3] = { x[i], y[i], z[i] };
+			double lengthSquared = (p[0] * p[0]) + (p[1] * p[1]) + (p[2] * p[2]);
+			bool hit = false;
+
+			for (int s = 0; s < sides.count; ++s) {
+
+				int a = sides.axis[s];
+				int b = (a + 1) % 3;
+				int c = (a + 2) % 3;
+
+				double ratio = sides.center[s][a] / p[a];
+				bool facing = (p[a] * sides.normalSign[s]) < 0. && (p[a] * p[a]) > MIN_FACING_SQUARED * lengthSquared;
+				bool onSide = std::abs((p[b] * ratio) - sides.center[s][b]) <= sides.halfWidth && std::abs((p[c] * ratio) - sides.center[s][c]) <= sides.halfWidth;
+
+				hit |= facing && onSide;
+			}
+
+			hits[i] = hit ? 1 : 0;
+		}
+	}
+}
+
+void intersectRaysWithSides(const FacingSides& sides, const double* x, const double* y, const double* z, std::size_t count, std::uint8_t* hits) {
+
+	std::size_t i = 0;
+
+#if defined(RAY_FACE_KERNEL_AVX2)
+
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d minFacing = _mm256_set1_pd(MIN_FACING_SQUARED);
+	const __m256d halfWidth = _mm256_set1_pd(sides.halfWidth);
+	const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+
+	for (; i + 4 <= count; i += 4) {
+
+		const __m256d p[3] = { _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), _mm256_loadu_pd(z + i) };
+		__m256d lengthSquared = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(p[0], p[0]), _mm256_mul_pd(p[1], p[1])), _mm256_mul_pd(p[2], p[2]));
+		__m256d hit = zero;
+
+		for (int s = 0; s < sides.count; ++s) {
+
+			int a = sides.axis[s];
+			int b = (a + 1) % 3;
+			int c = (a + 2) % 3;
+
+			__m256d ratio = _mm256_div_pd(_mm256_set1_pd(sides.center[s][a]), p[a]);
+			__m256d facing = _mm256_and_pd(
+				_mm256_cmp_pd(_mm256_mul_pd(p[a], _mm256_set1_pd(sides.normalSign[s])), zero, _CMP_LT_OQ),
+				_mm256_cmp_pd(_mm256_mul_pd(p[a], p[a]), _mm256_mul_pd(minFacing, lengthSquared), _CMP_GT_OQ));
+
+			__m256d toCenterB = _mm256_and_pd(absMask, _mm256_sub_pd(_mm256_mul_pd(p[b], ratio), _mm256_set1_pd(sides.center[s][b])));
+			__m256d toCenterC = _mm256_and_pd(absMask, _mm256_sub_pd(_mm256_mul_pd(p[c], ratio), _mm256_set1_pd(sides.center[s][c])));
+			__m256d onSide = _mm256_and_pd(_mm256_cmp_pd(toCenterB, halfWidth, _CMP_LE_OQ), _mm256_cmp_pd(toCenterC, halfWidth, _CMP_LE_OQ));
+
+			hit = _mm256_or_pd(hit, _mm256_and_pd(facing, onSide));
+		}
+
+		int mask = _mm256_movemask_pd(hit);
+		for (int k = 0; k < 4; ++k)
+			hits[i + k] = static_cast<std::uint8_t>((mask >> k) & 1);
+	}
+
+#elif defined(RAY_FACE_KERNEL_SSE2)
+
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d minFacing = _mm_set1_pd(MIN_FACING_SQUARED);
+	const __m128d halfWidth = _mm_set1_pd(sides.halfWidth);
+	const __m128d absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+
+	for (; i + 2 <= count; i += 2) {
+
+		const __m128d p[3] = { _mm_loadu_pd(x + i), _mm_loadu_pd(y + i), _mm_loadu_pd(z + i) };
+		__m128d lengthSquared = _mm_add_pd(_mm_add_pd(_mm_mul_pd(p[0], p[0]), _mm_mul_pd(p[1], p[1])), _mm_mul_pd(p[2], p[2]));
+		__m128d hit = zero;
+
+		for (int s = 0; s < sides.count; ++s) {
+
+			int a = sides.axis[s];
+			int b = (a + 1) % 3;
+			int c = (a + 2) % 3;
+
+			__m128d ratio = _mm_div_pd(_mm_set1_pd(sides.center[s][a]), p[a]);
+			__m128d facing = _mm_and_pd(
+				_mm_cmplt_pd(_mm_mul_pd(p[a], _mm_set1_pd(sides.normalSign[s])), zero),
+				_mm_cmpgt_pd(_mm_mul_pd(p[a], p[a]), _mm_mul_pd(minFacing, lengthSquared)));
+
+			__m128d toCenterB = _mm_and_pd(absMask, _mm_sub_pd(_mm_mul_pd(p[b], ratio), _mm_set1_pd(sides.center[s][b])));
+			__m128d toCenterC = _mm_and_pd(absMask, _mm_sub_pd(_mm_mul_pd(p[c], ratio), _mm_set1_pd(sides.center[s][c])));
+			__m128d onSide = _mm_and_pd(_mm_cmple_pd(toCenterB, halfWidth), _mm_cmple_pd(toCenterC, halfWidth));
+
+			hit = _mm_or_pd(hit, _mm_and_pd(facing, onSide));
+		}
+
+		int mask = _mm_movemask_pd(hit);
+		hits[i] = static_cast<std::uint8_t>(mask & 1);
+		hits[i + 1] = static_cast<std::uint8_t>((mask >> 1) & 1);
+	}
+
+#endif
+
+	intersectRaysWithSidesScalar(sides, x, y, z, i, count, hits);
+}
+
+const char* rayFaceKernelInstructionSet() {
+
+#if defined(RAY_FACE_KERNEL_AVX2)
+	return "AVX2";
+#elif defined(RAY_FACE_KERNEL_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/*
+	The sides of a blocking unit that face the shade origin.  Every side of a unit is axis aligned, so each is stored as the axis its normal
+	lies along, the sign of that normal, and the location of the side's center relative to the shade origin.
+*/
+struct FacingSides {
+
+	static const int MAX_SIDES = 5;
+
+	int count = 0;
+
+	// 0, 1, or 2 for a normal along x, y, or z
+	int axis[MAX_SIDES] = {};
+
+	// 1. or -1., the direction of the normal along its axis
+	double normalSign[MAX_SIDES] = {};
+
+	double center[MAX_SIDES][3] = {};
+
+	// Half of the width of a side plus the tolerance allowed for points of intersection on its edges
+	double halfWidth = 0.;
+
+	static const int MAX_BOUNDING_PLANES = 12;
+
+	// Normals of planes through the shade origin that every point whose ray hits a side is on the positive side of, or on.  Together they
+	// bound the frustrum beyond the sides.  There are none when the sides surround the origin.
+	int boundingPlaneCount = 0;
+	double boundingPlaneNormal[MAX_BOUNDING_PLANES][3] = {};
+
+	void add(int sideAxis, double sideNormalSign, double centerX, double centerY, double centerZ) {
+
+		axis[count] = sideAxis;
+		normalSign[count] = sideNormalSign;
+		center[count][0] = centerX;
+		center[count][1] = centerY;
+		center[count][2] = centerZ;
+		++count;
+	}
+
+	void addBoundingPlane(double normalX, double normalY, double normalZ) {
+
+		boundingPlaneNormal[boundingPlaneCount][0] = normalX;
+		boundingPlaneNormal[boundingPlaneCount][1] = normalY;
+		boundingPlaneNormal[boundingPlaneCount][2] = normalZ;
+		++boundingPlaneCount;
+	}
+
+	// Whether the axis aligned cube of half size h around (x, y, z) lies entirely on the negative side of one of the bounding planes, in
+	// which case no ray through it hits a side
+	bool cubeIsOutside(double x, double y, double z, double h) const {
+
+		for (int p = 0; p < boundingPlaneCount; ++p) {
+
+			const double* n = boundingPlaneNormal[p];
+			double reach = h * (std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]));
+			if ((n[0] * x) + (n[1] * y) + (n[2] * z) + reach < 0.)
+				return true;
+		}
+
+		return false;
+	}
+};
+
+/*
+	Tests rays from the shade origin through a batch of points against all of the facing sides at once.  The points are given as separate
+	arrays of x, y, and z coordinates, and hits[i] is set to 1 if the ray through point i passes through any of the sides, otherwise 0.
+
+	A ray hits a side if it points toward the side's normal (the same test as a dot product below -1e-6 with the normalized ray), and the point
+	where it meets the side's plane is within halfWidth of the side's center along both of the other axes.  Since the sides are axis aligned,
+	that point is the ray's point scaled by (side center / point) along the normal's axis, so no normalizing or branching is needed.
+
+	Uses AVX2 or SSE2 when the compiler targets them, and plain scalar code otherwise.
+*/
+void intersectRaysWithSides(const FacingSides& sides, const double* x, const double* y, const double* z, std::size_t count, std::uint8_t* hits);
+
+// The name of the instruction set intersectRaysWithSides was compiled for
+const char* rayFaceKernelInstructionSet();
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+#include "ShadeVectorGraph.h"
+
+void ShadeVectorGraph::clear() {
+
+	toUnits.clear();
+	shadeVectors.clear();
+	childOffsets.clear();
+	childIndices.clear();
+	percentShared.clear();
+	freeFieldStencil.clear();
+	stencilMin = Point_Int(0, 0, 0);
+	stencilMax = Point_Int(0, 0, 0);
+}
+
+void ShadeVectorGraph::freeze(const ShadeVector& root) {
+
+	clear();
+
+	// Number the nodes in breadth first order so that the root is node 0
+	std::vector<const ShadeVector*> nodes;
+	std::unordered_map<const ShadeVector*, Index> nodeIndices;
+	std::queue<const ShadeVector*> toVisit;
+	toVisit.push(&root);
+	nodeIndices[&root] = ROOT;
+
+	while (!toVisit.empty()) {
+
+		const ShadeVector* next = toVisit.front();
+		toVisit.pop();
+		nodes.push_back(next);
+
+		for (const auto& shared : next->neighborShadeVectors) {
+
+			if (nodeIndices.find(shared.neighbor.get()) == nodeIndices.end()) {
+
+				nodeIndices[shared.neighbor.get()] = static_cast<Index>(nodeIndices.size());
+				toVisit.push(shared.neighbor.get());
+			}
+		}
+	}
+
+	toUnits.reserve(nodes.size());
+	shadeVectors.reserve(nodes.size());
+	childOffsets.reserve(nodes.size() + 1);
+
+	for (const ShadeVector* sv : nodes) {
+
+		toUnits.push_back(sv->toUnit);
+		shadeVectors.push_back(sv->shadeVector);
+		childOffsets.push_back(static_cast<Index>(childIndices.size()));
+
+		for (const auto& shared : sv->neighborShadeVectors) {
+
+			childIndices.push_back(nodeIndices[shared.neighbor.get()]);
+			percentShared.push_back(shared.percentShared);
+		}
+	}
+
+	childOffsets.push_back(static_cast<Index>(childIndices.size()));
+
+	buildFreeFieldStencil();
+}
+
+void ShadeVectorGraph::buildFreeFieldStencil() {
+
+	freeFieldStencil.clear();
+	stencilMin = Point_Int(0, 0, 0);
+	stencilMax = Point_Int(0, 0, 0);
+
+	if (empty())
+		return;
+
+	// The same level by level walk as BlockPointGrid::propagateFrom, minus the grid, so the percentages are summed in the same order
+	PropagationScratch scratch;
+	scratch.prepare(size());
+
+	for (Index c = childOffsets[ROOT]; c < childOffsets[ROOT + 1]; ++c)
+		scratch.nextLevel.push_back({ childIndices[c], percentShared[c] });
+
+	scratch.advanceLevel();
+
+	while (!scratch.thisLevel.empty()) {
+
+		for (const auto& relay : scratch.thisLevel) {
+
+			const Point_Int& toUnit = toUnits[relay.sv];
+			stencilMin = Point_Int(std::min(stencilMin.x, toUnit.x), std::min(stencilMin.y, toUnit.y), std::min(stencilMin.z, toUnit.z));
+			stencilMax = Point_Int(std::max(stencilMax.x, toUnit.x), std::max(stencilMax.y, toUnit.y), std::max(stencilMax.z, toUnit.z));
+
+			freeFieldStencil.push_back(relay);
+			getChildren(relay.sv, relay.cumulativePercentage, scratch);
+		}
+
+		scratch.advanceLevel();
+	}
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <maya/MVector.h>
+
+#include "Point_Int.h"
+#include "ShadeVector.h"
+
+// Holds ShadeVectors as they are gathered to form the nextLevel / thisLevel lists during propagation
+struct SvRelay {
+
+	// Index of the ShadeVector in the ShadeVectorGraph
+	std::uint32_t sv = 0;
+
+	// The cumulative product of the ShadeVector's parents' percentShared as well as the cumulativePercentage from the units they were applied to.
+	double cumulativePercentage = 0.;
+};
+
+/*
+	Buffers reused by every propagation so that walking the graph neither allocates nor hashes.  thisLevel holds the relays being applied and
+	nextLevel gathers their children.  A ShadeVector is already in nextLevel only if its stamp equals generation, in which case slots gives
+	its position there.  Bumping generation empties that record for the next level without touching the arrays.
+*/
+struct PropagationScratch {
+
+	std::vector<SvRelay> thisLevel;
+	std::vector<SvRelay> nextLevel;
+
+	// Per node of the graph
+	std::vector<std::uint32_t> stamps;
+	std::vector<std::uint32_t> slots;
+
+	std::uint32_t generation = 1;
+
+	// Sizes the per node arrays for a graph with nodeCount nodes, if they aren't already
+	void prepare(std::size_t nodeCount) {
+
+		if (stamps.size() != nodeCount) {
+
+			stamps.assign(nodeCount, 0);
+			slots.assign(nodeCount, 0);
+			generation = 1;
+		}
+	}
+
+	// Moves nextLevel into thisLevel and starts an empty nextLevel
+	void advanceLevel() {
+
+		thisLevel.swap(nextLevel);
+		nextLevel.clear();
+
+		if (++generation == 0) {
+
+			std::fill(stamps.begin(), stamps.end(), 0);
+			generation = 1;
+		}
+	}
+};
+
+// A relay in a batched propagation.  Relays from different blockers are merged when they reach the same unit through the same ShadeVector,
+// so cumulativePercentage is signed: positive adds shade and negative removes it.
+struct BatchRelay {
+
+	// Grid index of the unit the ShadeVector is applied to
+	int x = 0;
+	int y = 0;
+	int z = 0;
+
+	std::uint32_t sv = 0;
+
+	double cumulativePercentage = 0.;
+
+	// The sum of the absolute values of the percentages merged into cumulativePercentage, used to tell when they have cancelled out
+	double magnitude = 0.;
+};
+
+// The relays of one level that fall within one tile of the grid.  A tile's relays are merged and expanded into children independently of the
+// other tiles', so each tile keeps its own buffers.
+struct BatchTile {
+
+	std::vector<BatchRelay> relays;
+	std::vector<BatchRelay> merged;
+	std::vector<BatchRelay> children;
+	std::unordered_map<std::uint64_t, std::uint32_t> slotsByKey;
+
+	// Used to put merged in Morton order of the relays' units
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> sortKeys;
+	std::vector<BatchRelay> sorted;
+};
+
+/*
+	Buffers reused by batched propagation.  Every ShadeVector is one unit further from the root than its parent, so relays are bucketed by
+	the level of their ShadeVector (the Manhattan length of its toUnit).  All of the relays for a level are in its bucket by the time it is
+	processed, where they are split among the tiles to be merged.
+*/
+struct BatchPropagationScratch {
+
+	std::vector<std::vector<BatchRelay>> levels;
+	std::vector<BatchTile> tiles;
+
+	std::vector<BatchRelay>& level(std::size_t level) {
+
+		if (levels.size() <= level)
+			levels.resize(level + 1);
+
+		return levels[level];
+	}
+};
+
+/*
+	A frozen, index based copy of the ShadeVector graph, used for propagation once the graph has been built.  Each ShadeVector is identified by its
+	index into the per node arrays, and the shadeRoot is always index ROOT.  The children of node i are stored contiguously in childIndices and
+	percentShared, from childOffsets[i] up to childOffsets[i + 1], in the same order as the ShadeVector's neighborShadeVectors.
+*/
+struct ShadeVectorGraph {
+
+	typedef std::uint32_t Index;
+
+	static const Index ROOT = 0;
+
+	// Per node
+	std::vector<Point_Int> toUnits;
+	std::vector<MVector> shadeVectors;
+
+	// childOffsets has one more element than there are nodes, so that every node's children end where the next node's begin
+	std::vector<Index> childOffsets;
+
+	// Per child
+	std::vector<Index> childIndices;
+	std::vector<double> percentShared;
+
+	// The shade laid down by propagating from ROOT with a starting percentage of 1. when no unit in its path is blocked, flattened into the
+	// order propagation applies it.  Each relay's ShadeVector is applied to the unit at the blocker's index plus that ShadeVector's toUnit.
+	std::vector<SvRelay> freeFieldStencil;
+
+	// The bounds of the toUnits in freeFieldStencil, including ROOT's own unit
+	Point_Int stencilMin;
+	Point_Int stencilMax;
+
+	std::size_t size() const { return toUnits.size(); }
+
+	bool empty() const { return toUnits.empty(); }
+
+	void clear();
+
+	// Replaces the contents with the graph reachable from root.  Nodes are numbered breadth first, so root becomes ROOT.
+	void freeze(const ShadeVector& root);
+
+	// Computes freeFieldStencil and its bounds from the frozen graph.  freeze calls this itself, but a graph loaded by other means must call it.
+	void buildFreeFieldStencil();
+
+	// The number of steps between ROOT and sv, which is the Manhattan length of its toUnit
+	int level(Index sv) const { return std::abs(toUnits[sv].x) + std::abs(toUnits[sv].y) + std::abs(toUnits[sv].z); }
+
+	// Used when propagating shade.  Adds the children of sv to scratch.nextLevel, summing the percentages of any that are already in it.
+	void getChildren(Index sv, double parentPercentage, PropagationScratch& scratch) const {
+
+		for (Index c = childOffsets[sv]; c < childOffsets[sv + 1]; ++c) {
+
+			Index child = childIndices[c];
+			if (scratch.stamps[child] != scratch.generation) {
+
+				scratch.stamps[child] = scratch.generation;
+				scratch.slots[child] = static_cast<std::uint32_t>(scratch.nextLevel.size());
+				scratch.nextLevel.push_back({ child, percentShared[c] * parentPercentage });
+			}
+			else {
+
+				scratch.nextLevel[scratch.slots[child]].cumulativePercentage += percentShared[c] * parentPercentage;
+			}
+		}
+	}
+};
@@ -0,0 +1,211 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include <maya/MGlobal.h>
+
+#include "ShadeVectorGraphCache.h"
+#include "MappedFile.h"
+
+namespace {
+
+	const char MAGIC[4] = { 'L', 'B', 'S', 'G' };
+
+	struct FileHeader {
+
+		char magic[4];
+		std::uint32_t version;
+		double unitSize;
+		double shadeRange;
+		double halfConeAngle;
+		std::int32_t subdivisionDepth;
+		std::uint32_t nodeCount;
+		std::uint32_t edgeCount;
+		std::uint32_t padding;
+		double maxVolumeBlocked;
+	};
+
+	struct NodeRecord {
+
+		std::int32_t toUnit[3];
+		std::uint32_t firstEdge;
+		double shadeVector[3];
+	};
+
+	struct EdgeRecord {
+
+		std::uint32_t child;
+		std::uint32_t padding;
+		double percentShared;
+	};
+
+	static_assert(sizeof(FileHeader) == 56, "ShadeVector graph cache header must have a fixed layout");
+	static_assert(sizeof(NodeRecord) == 40, "ShadeVector graph cache node record must have a fixed layout");
+	static_assert(sizeof(EdgeRecord) == 16, "ShadeVector graph cache edge record must have a fixed layout");
+
+	// FNV-1a over the raw bytes of the key, used only to name the file
+	std::uint64_t hashKey(const ShadeVectorGraphKey& key) {
+
+		std::uint64_t hash = 14695981039346656037ull;
+		auto hashBytes = [&hash](const void* data, std::size_t size) {
+
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for (std::size_t i = 0; i < size; ++i) {
+
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+		};
+
+		hashBytes(&key.unitSize, sizeof(key.unitSize));
+		hashBytes(&key.shadeRange, sizeof(key.shadeRange));
+		hashBytes(&key.halfConeAngle, sizeof(key.halfConeAngle));
+		hashBytes(&key.subdivisionDepth, sizeof(key.subdivisionDepth));
+
+		return hash;
+	}
+}
+
+std::string ShadeVectorGraphCache::getCachePath(const ShadeVectorGraphKey& key) {
+
+	std::filesystem::path cacheDir = MGlobal::executeCommandStringResult("internalVar -userAppDir").asChar();
+	if (cacheDir.empty())
+		cacheDir = std::filesystem::temp_directory_path();
+
+	cacheDir /= "lightBlockageCache";
+
+	std::error_code error;
+	std::filesystem::create_directories(cacheDir, error);
+
+	std::stringstream fileName;
+	fileName << "shadeVectorGraph_v" << VERSION << "_" << std::hex << std::setw(16) << std::setfill('0') << hashKey(key) << ".bin";
+
+	return (cacheDir / fileName.str()).string();
+}
+
+bool ShadeVectorGraphCache::load(const std::string& path, const ShadeVectorGraphKey& key, ShadeVectorGraph& graph, double& maxVolumeBlocked) {
+
+	MappedFile file;
+	if (!file.open(path) || file.size() < sizeof(FileHeader))
+		return false;
+
+	FileHeader header;
+	std::memcpy(&header, file.data(), sizeof(FileHeader));
+
+	ShadeVectorGraphKey fileKey = { header.unitSize, header.shadeRange, header.halfConeAngle, header.subdivisionDepth };
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || !(fileKey == key) || header.nodeCount == 0)
+		return false;
+
+	std::size_t expectedSize = sizeof(FileHeader) + (header.nodeCount * sizeof(NodeRecord)) + (header.edgeCount * sizeof(EdgeRecord));
+	if (file.size() != expectedSize) {
+
+		MGlobal::displayWarning(MString() + "ShadeVector graph cache file is truncated and will be rebuilt: " + path.c_str());
+		return false;
+	}
+
+	const unsigned char* nodeData = file.data() + sizeof(FileHeader);
+	const unsigned char* edgeData = nodeData + (header.nodeCount * sizeof(NodeRecord));
+
+	ShadeVectorGraph loaded;
+	loaded.toUnits.reserve(header.nodeCount);
+	loaded.shadeVectors.reserve(header.nodeCount);
+	loaded.childOffsets.reserve(header.nodeCount + 1);
+
+	for (std::uint32_t i = 0; i < header.nodeCount; ++i) {
+
+		NodeRecord record;
+		std::memcpy(&record, nodeData + (i * sizeof(NodeRecord)), sizeof(NodeRecord));
+
+		// Children must be stored in node order
+		if (record.firstEdge > header.edgeCount || (i > 0 && record.firstEdge < loaded.childOffsets.back()))
+			return false;
+
+		loaded.toUnits.push_back(Point_Int(record.toUnit[0], record.toUnit[1], record.toUnit[2]));
+		loaded.shadeVectors.push_back(MVector(record.shadeVector[0], record.shadeVector[1], record.shadeVector[2]));
+		loaded.childOffsets.push_back(record.firstEdge);
+	}
+
+	loaded.childOffsets.push_back(header.edgeCount);
+	loaded.childIndices.reserve(header.edgeCount);
+	loaded.percentShared.reserve(header.edgeCount);
+
+	for (std::uint32_t e = 0; e < header.edgeCount; ++e) {
+
+		EdgeRecord edge;
+		std::memcpy(&edge, edgeData + (e * sizeof(EdgeRecord)), sizeof(EdgeRecord));
+		if (edge.child >= header.nodeCount)
+			return false;
+
+		loaded.childIndices.push_back(edge.child);
+		loaded.percentShared.push_back(edge.percentShared);
+	}
+
+	graph = std::move(loaded);
+	maxVolumeBlocked = header.maxVolumeBlocked;
+
+	return true;
+}
+
+bool ShadeVectorGraphCache::save(const std::string& path, const ShadeVectorGraphKey& key, const ShadeVectorGraph& graph, double maxVolumeBlocked) {
+
+	std::vector<NodeRecord> nodeRecords(graph.size());
+	std::vector<EdgeRecord> edgeRecords(graph.childIndices.size());
+
+	for (std::size_t i = 0; i < graph.size(); ++i) {
+
+		NodeRecord& record = nodeRecords[i];
+		record.toUnit[0] = graph.toUnits[i].x;
+		record.toUnit[1] = graph.toUnits[i].y;
+		record.toUnit[2] = graph.toUnits[i].z;
+		record.firstEdge = graph.childOffsets[i];
+		record.shadeVector[0] = graph.shadeVectors[i].x;
+		record.shadeVector[1] = graph.shadeVectors[i].y;
+		record.shadeVector[2] = graph.shadeVectors[i].z;
+	}
+
+	for (std::size_t e = 0; e < graph.childIndices.size(); ++e) {
+
+		EdgeRecord& edge = edgeRecords[e];
+		edge = {};
+		edge.child = graph.childIndices[e];
+		edge.percentShared = graph.percentShared[e];
+	}
+
+	FileHeader header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.unitSize = key.unitSize;
+	header.shadeRange = key.shadeRange;
+	header.halfConeAngle = key.halfConeAngle;
+	header.subdivisionDepth = key.subdivisionDepth;
+	header.nodeCount = static_cast<std::uint32_t>(nodeRecords.size());
+	header.edgeCount = static_cast<std::uint32_t>(edgeRecords.size());
+	header.maxVolumeBlocked = maxVolumeBlocked;
+
+	std::string tempPath = path + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+			return false;
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(nodeRecords.data()), nodeRecords.size() * sizeof(NodeRecord));
+		out.write(reinterpret_cast<const char*>(edgeRecords.data()), edgeRecords.size() * sizeof(EdgeRecord));
+
+		if (!out)
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error) {
+
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
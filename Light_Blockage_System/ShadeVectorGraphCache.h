@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "ShadeVectorGraph.h"
+
+// The parameters that fully determine the ShadeVector graph.  Two grids with equal keys will build identical graphs.
+struct ShadeVectorGraphKey {
+
+	double unitSize = 0.;
+	double shadeRange = 0.;
+	double halfConeAngle = 0.;
+	int subdivisionDepth = 0;
+
+	bool operator==(const ShadeVectorGraphKey& rhs) const {
+
+		return unitSize == rhs.unitSize && shadeRange == rhs.shadeRange && halfConeAngle == rhs.halfConeAngle && subdivisionDepth == rhs.subdivisionDepth;
+	}
+};
+
+/*
+	Stores finished ShadeVector graphs on disk so that grids created with the same parameters do not have to rebuild them.
+	Each graph is written to its own file, named after a hash of its key.  The file begins with a header holding the full key,
+	so a hash collision or a file from an older version of the graph builder is detected and treated as a cache miss.
+
+	File layout (little-endian, fixed-size records):
+		FileHeader
+		NodeRecord[nodeCount]		In ShadeVectorGraph order, so the shadeRoot is always node 0
+		EdgeRecord[edgeCount]		Each node's children are stored contiguously, starting at its firstEdge
+*/
+class ShadeVectorGraphCache {
+
+public:
+
+	// Must be incremented whenever a change to the graph builder changes the values it produces
+	static const std::uint32_t VERSION = 5;
+
+	// Returns the path of the cache file for key, inside the user's Maya app directory.  Creates the cache directory if needed.
+	static std::string getCachePath(const ShadeVectorGraphKey& key);
+
+	// Reads the graph stored at path into graph and maxVolumeBlocked.  Returns false, leaving graph untouched, if the file
+	// does not exist, was written for a different key or version, or is malformed.
+	static bool load(const std::string& path, const ShadeVectorGraphKey& key, ShadeVectorGraph& graph, double& maxVolumeBlocked);
+
+	// Writes graph to path.  The file is written under a temporary name and then renamed, so readers never see a partial file.
+	static bool save(const std::string& path, const ShadeVectorGraphKey& key, const ShadeVectorGraph& graph, double maxVolumeBlocked);
+};
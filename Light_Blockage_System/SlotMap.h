@@ -0,0 +1,141 @@
+/*
+	A container that hands out stable handles to its elements.  Elements are kept contiguous, so iterating over them is a walk over one array,
+	and are moved when others are erased, so pointers and references to them are only valid until the next insert or erase.  Handles stay
+	valid until their element is erased.
+
+	Each handle pairs a slot with the generation of that slot when the element was inserted.  Erasing an element bumps its slot's generation,
+	so old handles to a reused slot are recognized as stale rather than reaching the new element.  Inserting, erasing, and looking up by
+	handle are all constant time.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct SlotMapHandle {
+
+	static const std::uint32_t NO_SLOT = 0xffffffff;
+
+	std::uint32_t slot = NO_SLOT;
+	std::uint32_t generation = 0;
+
+	bool operator==(const SlotMapHandle& rhs) const { return slot == rhs.slot && generation == rhs.generation; }
+	bool operator!=(const SlotMapHandle& rhs) const { return !(*this == rhs); }
+};
+
+template <typename T>
+class SlotMap {
+
+	struct Slot {
+
+		// Position of the slot's element in elements, or the next free slot if the slot is free
+		std::uint32_t index = 0;
+		std::uint32_t generation = 0;
+	};
+
+	std::vector<Slot> slots;
+
+	// The elements, and the slot of each, in the same order
+	std::vector<T> elements;
+	std::vector<std::uint32_t> elementSlots;
+
+	// Head of the list of free slots, linked through their index
+	std::uint32_t firstFreeSlot = SlotMapHandle::NO_SLOT;
+
+public:
+
+	std::size_t size() const { return elements.size(); }
+	bool empty() const { return elements.empty(); }
+
+	typename std::vector<T>::iterator begin() { return elements.begin(); }
+	typename std::vector<T>::iterator end() { return elements.end(); }
+	typename std::vector<T>::const_iterator begin() const { return elements.begin(); }
+	typename std::vector<T>::const_iterator end() const { return elements.end(); }
+
+	// The handle of the element at position i of the contiguous elements
+	SlotMapHandle handleAt(std::size_t i) const {
+
+		std::uint32_t slot = elementSlots[i];
+		return { slot, slots[slot].generation };
+	}
+
+	template <typename... Args>
+	SlotMapHandle emplace(Args&&... args) {
+
+		std::uint32_t slot = firstFreeSlot;
+		if (slot == SlotMapHandle::NO_SLOT) {
+
+			slot = static_cast<std::uint32_t>(slots.size());
+			slots.push_back(Slot());
+		}
+		else {
+
+			firstFreeSlot = slots[slot].index;
+		}
+
+		elements.emplace_back(std::forward<Args>(args)...);
+		elementSlots.push_back(slot);
+		slots[slot].index = static_cast<std::uint32_t>(elements.size() - 1);
+
+		return { slot, slots[slot].generation };
+	}
+
+	bool contains(const SlotMapHandle& handle) const {
+
+		return handle.slot < slots.size() && slots[handle.slot].generation == handle.generation && isOccupied(handle.slot);
+	}
+
+	// Returns the handle's element, or nullptr if it has been erased
+	T* get(const SlotMapHandle& handle) { return contains(handle) ? &elements[slots[handle.slot].index] : nullptr; }
+	const T* get(const SlotMapHandle& handle) const { return contains(handle) ? &elements[slots[handle.slot].index] : nullptr; }
+
+	// Erases the handle's element by moving the last element into its place.  Returns false if it had already been erased.
+	bool erase(const SlotMapHandle& handle) {
+
+		if (!contains(handle))
+			return false;
+
+		std::uint32_t index = slots[handle.slot].index;
+		std::uint32_t lastIndex = static_cast<std::uint32_t>(elements.size() - 1);
+
+		if (index != lastIndex) {
+
+			elements[index] = std::move(elements[lastIndex]);
+			elementSlots[index] = elementSlots[lastIndex];
+			slots[elementSlots[index]].index = index;
+		}
+
+		elements.pop_back();
+		elementSlots.pop_back();
+
+		++slots[handle.slot].generation;
+		slots[handle.slot].index = firstFreeSlot;
+		firstFreeSlot = handle.slot;
+
+		return true;
+	}
+
+	void clear() {
+
+		for (std::uint32_t slot : elementSlots) {
+
+			++slots[slot].generation;
+			slots[slot].index = firstFreeSlot;
+			firstFreeSlot = slot;
+		}
+
+		elements.clear();
+		elementSlots.clear();
+	}
+
+private:
+
+	bool isOccupied(std::uint32_t slot) const {
+
+		std::uint32_t index = slots[slot].index;
+		return index < elementSlots.size() && elementSlots[index] == slot;
+	}
+};
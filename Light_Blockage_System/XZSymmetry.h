@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdlib>
+
+#include <maya/MVector.h>
+
+#include "Point_Int.h"
+
+/*
+	The shade range is a cone around straight down, so the ShadeVector graph does not change when the x or z axis is mirrored or
+	when x and z are swapped.  An XZSymmetry is one of the 8 combinations of these operations.  Mirroring is applied before swapping.
+	The canonical octant is where 0 <= z <= x.  Every toUnit can be mapped into it, and only ShadeVectors there need to be computed.
+*/
+struct XZSymmetry {
+
+	bool mirrorX = false;
+	bool mirrorZ = false;
+	bool swapXZ = false;
+
+	// Returns the symmetry that maps p into the canonical octant
+	static XZSymmetry toCanonical(const Point_Int& p) {
+
+		XZSymmetry symmetry;
+		symmetry.mirrorX = p.x < 0;
+		symmetry.mirrorZ = p.z < 0;
+		symmetry.swapXZ = std::abs(p.z) > std::abs(p.x);
+
+		return symmetry;
+	}
+
+	static bool isCanonical(const Point_Int& p) { return 0 <= p.z && p.z <= p.x; }
+
+	Point_Int apply(const Point_Int& p) const {
+
+		int x = mirrorX ? -p.x : p.x;
+		int z = mirrorZ ? -p.z : p.z;
+
+		return swapXZ ? Point_Int(z, p.y, x) : Point_Int(x, p.y, z);
+	}
+
+	MVector applyInverse(const MVector& v) const {
+
+		double x = swapXZ ? v.z : v.x;
+		double z = swapXZ ? v.x : v.z;
+
+		return MVector(mirrorX ? -x : x, v.y, mirrorZ ? -z : z);
+	}
+};
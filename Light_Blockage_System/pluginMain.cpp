@@ -7,6 +7,7 @@
 
 #include "CreateBlockPointGrid.h"
 #include "ModifyBlockPoints.h"
+#include "ModifyOccluders.h"
 #include "UpdateGridDisplay.h"
 
 MStatus initializePlugin(MObject obj)
@@ -21,6 +22,9 @@ MStatus initializePlugin(MObject obj)
     status = fnPlugin.registerCommand("modifyBlockPoints", ModifyBlockPoints::creator, ModifyBlockPoints::newSyntax);
     CHECK_MSTATUS_AND_RETURN_IT(status);
 
+    status = fnPlugin.registerCommand("modifyOccluders", ModifyOccluders::creator, ModifyOccluders::newSyntax);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
     status = fnPlugin.registerCommand("updateGridDisplay", UpdateGridDisplay::creator, UpdateGridDisplay::newSyntax);
     CHECK_MSTATUS_AND_RETURN_IT(status);
 
@@ -39,6 +43,9 @@ MStatus uninitializePlugin(MObject obj)
     status = fnPlugin.deregisterCommand("modifyBlockPoints");
     CHECK_MSTATUS_AND_RETURN_IT(status);
 
+    status = fnPlugin.deregisterCommand("modifyOccluders");
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
     status = fnPlugin.deregisterCommand("updateGridDisplay");
     CHECK_MSTATUS_AND_RETURN_IT(status);
 
@@ -0,0 +1,243 @@
+/*
+	Checks CapsuleOccluder::rasterize against a brute force distance test of every unit, and forEachCoverageDifference against the set
+	differences of the units in two coverages.  Nothing here depends on Maya, so it builds on its own, e.g.
+
+	g++ -std=c++17 -O2 -I../Light_Blockage_System CapsuleOccluderTest.cpp ../Light_Blockage_System/CapsuleOccluder.cpp -o CapsuleOccluderTest
+
+	Prints each failure and exits with 1 if there were any.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "CapsuleOccluder.h"
+
+namespace {
+
+	typedef std::tuple<int, int, int> Index;
+
+	int failures = 0;
+
+	void check(bool passed, const char* what, int capsule, const Index& index) {
+
+		if (passed)
+			return;
+
+		if (++failures <= 20)
+			std::printf("FAILED: %s for capsule %d at (%d, %d, %d)\n", what, capsule, std::get<0>(index), std::get<1>(index), std::get<2>(index));
+	}
+
+	// The grid every capsule is rasterized onto
+	const double FIRST_CENTER[3] = { -6.1, -3.3, -7.05 };
+	const double UNIT_SIZE = .5;
+	const int X = 24;
+	const int Y = 20;
+	const int Z = 28;
+
+	// Distances this close to the radius could fall either way, so units at them aren't checked
+	const double TOLERANCE = 1e-9;
+
+	struct Capsule {
+
+		double start[3];
+		double end[3];
+		double radius;
+	};
+
+	std::vector<CoverageRun> rasterize(const Capsule& capsule) {
+
+		std::vector<CoverageRun> runs;
+		CapsuleOccluder(capsule.start, capsule.end, capsule.radius, 1).rasterize(FIRST_CENTER, UNIT_SIZE, X, Y, Z, runs);
+
+		return runs;
+	}
+
+	std::set<Index> unitsOf(const std::vector<CoverageRun>& runs) {
+
+		std::set<Index> units;
+		for (const auto& run : runs) {
+			for (int z = run.zBegin; z < run.zEnd; ++z)
+				units.insert(Index(run.x, run.y, z));
+		}
+
+		return units;
+	}
+
+	// The index of the unit a point is in, whether or not it is on the grid
+	Index unitOf(const double p[3]) {
+
+		return Index(static_cast<int>(std::floor(((p[0] - FIRST_CENTER[0]) / UNIT_SIZE) + .5)),
+			static_cast<int>(std::floor(((p[1] - FIRST_CENTER[1]) / UNIT_SIZE) + .5)),
+			static_cast<int>(std::floor(((p[2] - FIRST_CENTER[2]) / UNIT_SIZE) + .5)));
+	}
+
+	// The distance from p to the segment from a to b
+	double distanceToSegment(const double p[3], const double a[3], const double b[3]) {
+
+		double ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		double ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+		double lengthSquared = (ab[0] * ab[0]) + (ab[1] * ab[1]) + (ab[2] * ab[2]);
+		double t = lengthSquared > 0. ? std::min(std::max(((ap[0] * ab[0]) + (ap[1] * ab[1]) + (ap[2] * ab[2])) / lengthSquared, 0.), 1.) : 0.;
+
+		double offset[3] = { ap[0] - (ab[0] * t), ap[1] - (ab[1] * t), ap[2] - (ab[2] * t) };
+		return std::sqrt((offset[0] * offset[0]) + (offset[1] * offset[1]) + (offset[2] * offset[2]));
+	}
+
+	/*
+		The runs must be ordered by x and then y, with one nonempty run per row, all on the grid.  They must cover exactly the units whose centers
+		are within the radius of the segment, plus the units the endpoints are in.  A row only holds one run, so in a row with an endpoint's unit
+		the units between it and the rest of the row's coverage are covered too.
+	*/
+	void testRasterize(int id, const Capsule& capsule) {
+
+		std::vector<CoverageRun> runs = rasterize(capsule);
+
+		for (std::size_t i = 0; i < runs.size(); ++i) {
+
+			const CoverageRun& run = runs[i];
+			Index first(run.x, run.y, run.zBegin);
+
+			check(run.x >= 0 && run.x < X && run.y >= 0 && run.y < Y && run.zBegin >= 0 && run.zEnd <= Z, "run off the grid", id, first);
+			check(run.zBegin < run.zEnd, "empty run", id, first);
+			if (i > 0)
+				check(std::make_pair(runs[i - 1].x, runs[i - 1].y) < std::make_pair(run.x, run.y), "runs out of order", id, first);
+		}
+
+		std::set<Index> covered = unitsOf(runs);
+		Index startUnit = unitOf(capsule.start);
+		Index endUnit = unitOf(capsule.end);
+
+		for (int x = 0; x < X; ++x) {
+			for (int y = 0; y < Y; ++y) {
+
+				// The units of the row that must be covered.  An endpoint's unit may be off the grid, in which case the span reaches its edge.
+				std::vector<int> required;
+				for (int z = 0; z < Z; ++z) {
+
+					const double center[3] = { FIRST_CENTER[0] + (x * UNIT_SIZE), FIRST_CENTER[1] + (y * UNIT_SIZE), FIRST_CENTER[2] + (z * UNIT_SIZE) };
+					if (distanceToSegment(center, capsule.start, capsule.end) < capsule.radius - TOLERANCE)
+						required.push_back(z);
+				}
+
+				bool hasEndpoint = false;
+				for (const Index& endpointUnit : { startUnit, endUnit }) {
+
+					if (std::get<0>(endpointUnit) == x && std::get<1>(endpointUnit) == y) {
+
+						hasEndpoint = true;
+						required.push_back(std::get<2>(endpointUnit));
+					}
+				}
+
+				std::sort(required.begin(), required.end());
+
+				for (int z = 0; z < Z; ++z) {
+
+					Index index(x, y, z);
+					const double center[3] = { FIRST_CENTER[0] + (x * UNIT_SIZE), FIRST_CENTER[1] + (y * UNIT_SIZE), FIRST_CENTER[2] + (z * UNIT_SIZE) };
+					bool isCovered = covered.count(index) != 0;
+					bool spanned = hasEndpoint && !required.empty() && z >= required.front() && z <= required.back();
+
+					if (std::find(required.begin(), required.end(), z) != required.end())
+						check(isCovered, index == startUnit || index == endUnit ? "endpoint unit missing" : "unit within radius missing", id, index);
+					else if (spanned)
+						check(isCovered, "unit between endpoint and coverage missing", id, index);
+					else if (distanceToSegment(center, capsule.start, capsule.end) > capsule.radius + TOLERANCE)
+						check(!isCovered, "unit beyond radius covered", id, index);
+				}
+			}
+		}
+	}
+
+	/*
+		forEachCoverageDifference must report exactly the units of before that aren't in after as leaving, and those of after that aren't in
+		before as entering, each once.
+	*/
+	void testDifference(int id, const std::vector<CoverageRun>& before, const std::vector<CoverageRun>& after) {
+
+		std::set<Index> beforeUnits = unitsOf(before);
+		std::set<Index> afterUnits = unitsOf(after);
+		std::multiset<Index> leaving;
+		std::multiset<Index> entering;
+
+		CapsuleOccluder::forEachCoverageDifference(before, after,
+			[&](int x, int y, int zBegin, int zEnd) { for (int z = zBegin; z < zEnd; ++z) leaving.insert(Index(x, y, z)); },
+			[&](int x, int y, int zBegin, int zEnd) { for (int z = zBegin; z < zEnd; ++z) entering.insert(Index(x, y, z)); });
+
+		std::multiset<Index> expectLeaving;
+		std::multiset<Index> expectEntering;
+		std::set_difference(beforeUnits.begin(), beforeUnits.end(), afterUnits.begin(), afterUnits.end(), std::inserter(expectLeaving, expectLeaving.end()));
+		std::set_difference(afterUnits.begin(), afterUnits.end(), beforeUnits.begin(), beforeUnits.end(), std::inserter(expectEntering, expectEntering.end()));
+
+		check(leaving == expectLeaving, "leaving units differ", id, Index(-1, -1, -1));
+		check(entering == expectEntering, "entering units differ", id, Index(-1, -1, -1));
+	}
+}
+
+int main() {
+
+	std::mt19937 random(21);
+	std::uniform_real_distribution<double> unit(0., 1.);
+
+	// Mostly on the grid, but reaching off of it on every side
+	auto randomPoint = [&](double p[3]) {
+
+		p[0] = FIRST_CENTER[0] - 2. + (unit(random) * ((X * UNIT_SIZE) + 4.));
+		p[1] = FIRST_CENTER[1] - 2. + (unit(random) * ((Y * UNIT_SIZE) + 4.));
+		p[2] = FIRST_CENTER[2] - 2. + (unit(random) * ((Z * UNIT_SIZE) + 4.));
+	};
+
+	std::vector<Capsule> capsules;
+	for (int i = 0; i < 200; ++i) {
+
+		Capsule capsule;
+		randomPoint(capsule.start);
+		randomPoint(capsule.end);
+
+		// Some thinner than a unit, some several units wide
+		capsule.radius = i % 4 == 0 ? unit(random) * UNIT_SIZE * .5 : .1 + (unit(random) * 2.5);
+
+		// Degenerate segments: a sphere, an axis along z, and an axis perpendicular to z
+		if (i % 10 == 1)
+			std::copy(capsule.start, capsule.start + 3, capsule.end);
+		else if (i % 10 == 2)
+			std::copy(capsule.start, capsule.start + 2, capsule.end);
+		else if (i % 10 == 3)
+			capsule.end[2] = capsule.start[2];
+
+		capsules.push_back(capsule);
+	}
+
+	for (std::size_t i = 0; i < capsules.size(); ++i)
+		testRasterize(static_cast<int>(i), capsules[i]);
+
+	// Small moves, like a swaying branch, and jumps to unrelated capsules
+	for (std::size_t i = 0; i < capsules.size(); ++i) {
+
+		Capsule moved = capsules[i];
+		for (int axis = 0; axis < 3; ++axis)
+			moved.end[axis] += (unit(random) - .5) * UNIT_SIZE * 2.;
+
+		std::vector<CoverageRun> before = rasterize(capsules[i]);
+		std::vector<CoverageRun> swayed = rasterize(moved);
+		std::vector<CoverageRun> other = rasterize(capsules[(i + 1) % capsules.size()]);
+
+		testDifference(static_cast<int>(i), before, swayed);
+		testDifference(static_cast<int>(i), before, other);
+		testDifference(static_cast<int>(i), before, std::vector<CoverageRun>());
+		testDifference(static_cast<int>(i), std::vector<CoverageRun>(), before);
+		testDifference(static_cast<int>(i), before, before);
+	}
+
+	if (failures == 0)
+		std::printf("PASSED\n");
+	else
+		std::printf("%d checks FAILED\n", failures);
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,250 @@
+/*
+	Checks MeshVoxelizer::voxelize against analytic expectations for a box and a UV sphere.  Nothing here depends on Maya, so it builds on its
+	own, e.g.
+
+	g++ -std=c++17 -O2 -pthread -I../Light_Blockage_System MeshVoxelizerTest.cpp ../Light_Blockage_System/MeshVoxelizer.cpp -o MeshVoxelizerTest
+
+	Prints each failure and exits with 1 if there were any.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "MeshVoxelizer.h"
+
+namespace {
+
+	typedef std::tuple<int, int, int> Index;
+
+	int failures = 0;
+
+	void check(bool passed, const char* what, const Index& index) {
+
+		if (passed)
+			return;
+
+		if (++failures <= 20)
+			std::printf("FAILED: %s at (%d, %d, %d)\n", what, std::get<0>(index), std::get<1>(index), std::get<2>(index));
+	}
+
+	// The grid every mesh is voxelized onto
+	const double FIRST_CENTER[3] = { -5., -5., -5. };
+	const double UNIT_SIZE = .25;
+	const int X = 40;
+	const int Y = 36;
+	const int Z = 40;
+
+	double unitCenter(int i, int axis) { return FIRST_CENTER[axis] + (i * UNIT_SIZE); }
+
+	std::set<Index> voxelize(const std::vector<float>& vertices, const std::vector<std::uint32_t>& indices, bool solid, unsigned int threadCount) {
+
+		VoxelizedMesh mesh = MeshVoxelizer::voxelize(vertices, indices, FIRST_CENTER, UNIT_SIZE, X, Y, Z, solid, threadCount);
+
+		std::set<Index> covered;
+		mesh.forEachOccupied([&](int x, int y, int z) {
+
+			Index index(x, y, z);
+			check(x >= 0 && x < X && y >= 0 && y < Y && z >= 0 && z < Z, "unit off the grid", index);
+			covered.insert(index);
+		});
+
+		return covered;
+	}
+
+	// Voxelizes with one thread and with several, which must agree, and returns the units covered
+	std::set<Index> voxelizeBothWays(const std::vector<float>& vertices, const std::vector<std::uint32_t>& indices, bool solid) {
+
+		std::set<Index> covered = voxelize(vertices, indices, solid, 1);
+		check(covered == voxelize(vertices, indices, solid, 4), "threaded result differs", Index(-1, -1, -1));
+
+		return covered;
+	}
+
+	template <typename Func>
+	void forEachUnit(Func func) {
+
+		for (int x = 0; x < X; ++x) {
+			for (int y = 0; y < Y; ++y) {
+				for (int z = 0; z < Z; ++z)
+					func(Index(x, y, z), unitCenter(x, 0), unitCenter(y, 1), unitCenter(z, 2));
+			}
+		}
+	}
+
+	/*
+		An axis aligned box from lo to hi.  The SAT test is exact for axis aligned faces, so the surface covers exactly the units whose cubes meet
+		the box but don't lie inside of its open interior.  Solid also covers the units whose centers are inside it.  The corners are chosen so
+		that no face lies on a unit's side or center.
+	*/
+	void testBox(const double lo[3], const double hi[3]) {
+
+		std::vector<float> vertices;
+		for (int corner = 0; corner < 8; ++corner) {
+
+			vertices.push_back(static_cast<float>(corner & 1 ? hi[0] : lo[0]));
+			vertices.push_back(static_cast<float>(corner & 2 ? hi[1] : lo[1]));
+			vertices.push_back(static_cast<float>(corner & 4 ? hi[2] : lo[2]));
+		}
+
+		// Two triangles for each face, wound outward
+		const std::vector<std::uint32_t> indices = {
+			0, 2, 6, 0, 6, 4,
+			1, 5, 7, 1, 7, 3,
+			0, 4, 5, 0, 5, 1,
+			2, 3, 7, 2, 7, 6,
+			0, 1, 3, 0, 3, 2,
+			4, 6, 7, 4, 7, 5 };
+
+		std::set<Index> surface = voxelizeBothWays(vertices, indices, false);
+		std::set<Index> solid = voxelizeBothWays(vertices, indices, true);
+		double h = UNIT_SIZE * .5;
+
+		forEachUnit([&](const Index& index, double x, double y, double z) {
+
+			const double center[3] = { x, y, z };
+			bool meetsBox = true;
+			bool inInterior = true;
+			bool centerInside = true;
+
+			for (int axis = 0; axis < 3; ++axis) {
+
+				meetsBox &= center[axis] - h <= hi[axis] && center[axis] + h >= lo[axis];
+				inInterior &= center[axis] - h > lo[axis] && center[axis] + h < hi[axis];
+				centerInside &= center[axis] > lo[axis] && center[axis] < hi[axis];
+			}
+
+			bool expectSurface = meetsBox && !inInterior;
+			check(surface.count(index) == (expectSurface ? 1u : 0u), expectSurface ? "box surface unit missing" : "box surface unit extra", index);
+			check(solid.count(index) == (expectSurface || centerInside ? 1u : 0u), expectSurface || centerInside ? "box solid unit missing" : "box solid unit extra", index);
+		});
+	}
+
+	/*
+		A closed UV sphere.  Its triangles lie between the sphere and an inner sphere at the smallest distance of any triangle's plane from the
+		center, so units whose cubes reach past both spheres must be on the surface, and units whose cubes miss the shell between them can't be.
+		Solid must also cover every unit whose center is inside the inner sphere, and nothing whose cube is entirely outside of the sphere.
+	*/
+	void testSphere(const double center[3], double radius, int segments, int rings) {
+
+		std::vector<float> vertices;
+		auto addVertex = [&](double theta, double phi) {
+
+			vertices.push_back(static_cast<float>(center[0] + (radius * std::sin(theta) * std::cos(phi))));
+			vertices.push_back(static_cast<float>(center[1] + (radius * std::cos(theta))));
+			vertices.push_back(static_cast<float>(center[2] + (radius * std::sin(theta) * std::sin(phi))));
+		};
+
+		const double pi = std::acos(-1.);
+		addVertex(0., 0.);
+		for (int ring = 1; ring < rings; ++ring) {
+			for (int segment = 0; segment < segments; ++segment)
+				addVertex(pi * ring / rings, 2. * pi * segment / segments);
+		}
+		addVertex(pi, 0.);
+
+		std::uint32_t bottom = static_cast<std::uint32_t>(vertices.size() / 3) - 1;
+		auto ringVertex = [&](int ring, int segment) { return static_cast<std::uint32_t>(1 + ((ring - 1) * segments) + (segment % segments)); };
+
+		std::vector<std::uint32_t> indices;
+		for (int segment = 0; segment < segments; ++segment) {
+
+			indices.insert(indices.end(), { 0, ringVertex(1, segment + 1), ringVertex(1, segment) });
+			indices.insert(indices.end(), { bottom, ringVertex(rings - 1, segment), ringVertex(rings - 1, segment + 1) });
+
+			for (int ring = 1; ring + 1 < rings; ++ring) {
+
+				indices.insert(indices.end(), { ringVertex(ring, segment), ringVertex(ring, segment + 1), ringVertex(ring + 1, segment + 1) });
+				indices.insert(indices.end(), { ringVertex(ring, segment), ringVertex(ring + 1, segment + 1), ringVertex(ring + 1, segment) });
+			}
+		}
+
+		// The plane of a triangle with its corners on the sphere is sqrt(r^2 - R^2) from the center, where R is the triangle's circumradius
+		double innerRadius = radius;
+		for (std::size_t t = 0; t < indices.size(); t += 3) {
+
+			double p[3][3];
+			for (int corner = 0; corner < 3; ++corner) {
+				for (int axis = 0; axis < 3; ++axis)
+					p[corner][axis] = vertices[(indices[t + corner] * 3) + axis];
+			}
+
+			double a = std::sqrt(std::pow(p[1][0] - p[2][0], 2) + std::pow(p[1][1] - p[2][1], 2) + std::pow(p[1][2] - p[2][2], 2));
+			double b = std::sqrt(std::pow(p[0][0] - p[2][0], 2) + std::pow(p[0][1] - p[2][1], 2) + std::pow(p[0][2] - p[2][2], 2));
+			double c = std::sqrt(std::pow(p[0][0] - p[1][0], 2) + std::pow(p[0][1] - p[1][1], 2) + std::pow(p[0][2] - p[1][2], 2));
+			double s = (a + b + c) * .5;
+			double area = std::sqrt(std::max(s * (s - a) * (s - b) * (s - c), 0.));
+			double circumradius = (a * b * c) / (4. * area);
+
+			innerRadius = std::min(innerRadius, std::sqrt(std::max((radius * radius) - (circumradius * circumradius), 0.)));
+		}
+
+		// Allows for the vertices having been rounded to floats
+		const double tolerance = 1e-4;
+		double h = UNIT_SIZE * .5;
+
+		std::set<Index> surface = voxelizeBothWays(vertices, indices, false);
+		std::set<Index> solid = voxelizeBothWays(vertices, indices, true);
+
+		forEachUnit([&](const Index& index, double x, double y, double z) {
+
+			const double offset[3] = { x - center[0], y - center[1], z - center[2] };
+			double nearest = 0.;
+			double farthest = 0.;
+			for (int axis = 0; axis < 3; ++axis) {
+
+				nearest += std::pow(std::max(std::abs(offset[axis]) - h, 0.), 2);
+				farthest += std::pow(std::abs(offset[axis]) + h, 2);
+			}
+
+			nearest = std::sqrt(nearest);
+			farthest = std::sqrt(farthest);
+			double centerDistance = std::sqrt((offset[0] * offset[0]) + (offset[1] * offset[1]) + (offset[2] * offset[2]));
+
+			bool onSurface = surface.count(index) != 0;
+			bool inSolid = solid.count(index) != 0;
+
+			if (nearest < innerRadius - tolerance && farthest > radius + tolerance)
+				check(onSurface, "sphere surface unit missing", index);
+
+			if (nearest > radius + tolerance || farthest < innerRadius - tolerance)
+				check(!onSurface, "sphere surface unit extra", index);
+
+			if (centerDistance < innerRadius - tolerance)
+				check(inSolid, "sphere solid unit missing", index);
+
+			if (nearest > radius + tolerance)
+				check(!inSolid, "sphere solid unit extra", index);
+
+			if (onSurface)
+				check(inSolid, "sphere surface unit not in solid", index);
+		});
+	}
+}
+
+int main() {
+
+	// Entirely on the grid
+	const double boxLo[3] = { -1.625, -2.875, .125 };
+	const double boxHi[3] = { 1.375, .625, 2.875 };
+	testBox(boxLo, boxHi);
+
+	// Reaching off of the grid on both ends of x and the far end of y, which is ignored
+	const double clippedLo[3] = { -7.125, 1.125, -3.875 };
+	const double clippedHi[3] = { 6.375, 8.625, -2.125 };
+	testBox(clippedLo, clippedHi);
+
+	const double sphereCenter[3] = { .1, .2, -.15 };
+	testSphere(sphereCenter, 3.3, 48, 24);
+	testSphere(sphereCenter, 1.05, 12, 6);
+
+	if (failures == 0)
+		std::printf("PASSED\n");
+	else
+		std::printf("%d checks FAILED\n", failures);
+
+	return failures == 0 ? 0 : 1;
+}